@@ -58,6 +58,7 @@
 #define DHCP_OPT_MAX_MSG_SIZE       (57)
 #define DHCP_OPT_VENDOR_CLASS_ID    (60)
 #define DHCP_OPT_CLIENT_ID          (61)
+#define DHCP_OPT_RAPID_COMMIT       (80) // RFC 4039
 #define DHCP_OPT_END                (255)
 
 #define PORT_DHCP_SERVER (67)
@@ -65,7 +66,7 @@
 
 #define DEFAULT_LEASE_TIME_S (24 * 60 * 60) // in seconds
 
-#define MAC_LEN (6)
+#define MAC_LEN (DHCPS_MAC_LEN)
 #define MAKE_IP4(a, b, c, d) ((a) << 24 | (b) << 16 | (c) << 8 | (d))
 
 typedef struct {
@@ -180,6 +181,53 @@ static void opt_write_u32(uint8_t **opt, uint8_t cmd, uint32_t val) {
     *opt = o;
 }
 
+static const uint8_t empty_mac[MAC_LEN];
+
+static bool lease_expired(const dhcp_server_lease_t *lease) {
+    uint32_t expiry = lease->expiry << 16 | 0xffff;
+    return (int32_t)(expiry - cyw43_hal_ticks_ms()) < 0;
+}
+
+// Home slot of a MAC, FNV-1a
+static int lease_home(const uint8_t *mac) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < MAC_LEN; ++i) {
+        h = (h ^ mac[i]) * 16777619u;
+    }
+    return (h ^ h >> 16) & (DHCPS_MAX_IP - 1);
+}
+
+// Walks the slots from the home slot of mac. Returns the lease of mac, else
+// the first free lease, else the first expired one, else DHCPS_MAX_IP. A
+// known client is found at its home slot unless that was taken
+static int lease_find(dhcp_server_t *d, const uint8_t *mac) {
+    int home = lease_home(mac);
+    int free_yi = DHCPS_MAX_IP;
+    int expired_yi = DHCPS_MAX_IP;
+    for (int n = 0; n < DHCPS_MAX_IP; ++n) {
+        int i = (home + n) & (DHCPS_MAX_IP - 1);
+        if (memcmp(d->lease[i].mac, mac, MAC_LEN) == 0) {
+            return i;
+        }
+        if (memcmp(d->lease[i].mac, empty_mac, MAC_LEN) == 0) {
+            if (free_yi == DHCPS_MAX_IP) {
+                free_yi = i;
+            }
+        } else if (expired_yi == DHCPS_MAX_IP && lease_expired(&d->lease[i])) {
+            expired_yi = i;
+        }
+    }
+    return free_yi != DHCPS_MAX_IP ? free_yi : expired_yi;
+}
+
+static void lease_bind(dhcp_server_t *d, int yi, const uint8_t *mac) {
+    if (memcmp(d->lease[yi].mac, mac, MAC_LEN) != 0) {
+        memcpy(d->lease[yi].mac, mac, MAC_LEN);
+        d->leases_changed = true;
+    }
+    d->lease[yi].expiry = (cyw43_hal_ticks_ms() + DEFAULT_LEASE_TIME_S * 1000) >> 16;
+}
+
 static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *src_addr, u16_t src_port) {
     dhcp_server_t *d = arg;
     (void)upcb;
@@ -213,33 +261,23 @@ static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
 
     switch (msgtype[2]) {
         case DHCPDISCOVER: {
-            int yi = DHCPS_MAX_IP;
-            for (int i = 0; i < DHCPS_MAX_IP; ++i) {
-                if (memcmp(d->lease[i].mac, dhcp_msg.chaddr, MAC_LEN) == 0) {
-                    // MAC match, use this IP address
-                    yi = i;
-                    break;
-                }
-                if (yi == DHCPS_MAX_IP) {
-                    // Look for a free IP address
-                    if (memcmp(d->lease[i].mac, "\x00\x00\x00\x00\x00\x00", MAC_LEN) == 0) {
-                        // IP available
-                        yi = i;
-                    }
-                    uint32_t expiry = d->lease[i].expiry << 16 | 0xffff;
-                    if ((int32_t)(expiry - cyw43_hal_ticks_ms()) < 0) {
-                        // IP expired, reuse it
-                        memset(d->lease[i].mac, 0, MAC_LEN);
-                        yi = i;
-                    }
-                }
-            }
+            int yi = lease_find(d, dhcp_msg.chaddr);
             if (yi == DHCPS_MAX_IP) {
                 // No more IP addresses left
                 goto ignore_request;
             }
             dhcp_msg.yiaddr[3] = DHCPS_BASE_IP + yi;
-            opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPOFFER);
+            if (opt_find(opt, DHCP_OPT_RAPID_COMMIT) != NULL) {
+                // Two-message exchange: the lease is committed by the ACK
+                lease_bind(d, yi, dhcp_msg.chaddr);
+                opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPACK);
+                *opt++ = DHCP_OPT_RAPID_COMMIT;
+                *opt++ = 0;
+            } else {
+                // The previous holder of an expired lease loses it only
+                // once the new client requests it
+                opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPOFFER);
+            }
             break;
         }
 
@@ -260,15 +298,14 @@ static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
             }
             if (memcmp(d->lease[yi].mac, dhcp_msg.chaddr, MAC_LEN) == 0) {
                 // MAC match, ok to use this IP address
-            } else if (memcmp(d->lease[yi].mac, "\x00\x00\x00\x00\x00\x00", MAC_LEN) == 0) {
-                // IP unused, ok to use this IP address
-                memcpy(d->lease[yi].mac, dhcp_msg.chaddr, MAC_LEN);
+            } else if (memcmp(d->lease[yi].mac, empty_mac, MAC_LEN) == 0 || lease_expired(&d->lease[yi])) {
+                // IP unused or expired, ok to use this IP address
             } else {
                 // IP already in use
                 // Should be NACK
                 goto ignore_request;
             }
-            d->lease[yi].expiry = (cyw43_hal_ticks_ms() + DEFAULT_LEASE_TIME_S * 1000) >> 16;
+            lease_bind(d, yi, dhcp_msg.chaddr);
             dhcp_msg.yiaddr[3] = DHCPS_BASE_IP + yi;
             opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPACK);
             printf("DHCPS: client connected: MAC=%02x:%02x:%02x:%02x:%02x:%02x IP=%u.%u.%u.%u\n",
@@ -277,6 +314,15 @@ static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
             break;
         }
 
+        case DHCPRELEASE: {
+            uint8_t yi = dhcp_msg.ciaddr[3] - DHCPS_BASE_IP;
+            if (yi < DHCPS_MAX_IP && memcmp(d->lease[yi].mac, dhcp_msg.chaddr, MAC_LEN) == 0) {
+                // Expired, the MAC is kept to hand out the same address again
+                d->lease[yi].expiry = (cyw43_hal_ticks_ms() >> 16) - 1;
+            }
+            goto ignore_request;
+        }
+
         default:
             goto ignore_request;
     }
@@ -297,7 +343,6 @@ ignore_request:
 void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm) {
     ip_addr_copy(d->ip, *ip);
     ip_addr_copy(d->nm, *nm);
-    memset(d->lease, 0, sizeof(d->lease));
     if (dhcp_socket_new_dgram(&d->udp, d, dhcp_server_process) != 0) {
         return;
     }
@@ -307,3 +352,22 @@ void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm) {
 void dhcp_server_deinit(dhcp_server_t *d) {
     dhcp_socket_free(&d->udp);
 }
+
+void dhcp_server_import_leases(dhcp_server_t *d, const uint8_t macs[DHCPS_MAX_IP][DHCPS_MAC_LEN]) {
+    // Lease times do not survive a reboot, the leases are renewed on request
+    uint16_t expired = (cyw43_hal_ticks_ms() >> 16) - 1;
+    for (int i = 0; i < DHCPS_MAX_IP; ++i) {
+        memcpy(d->lease[i].mac, macs[i], MAC_LEN);
+        d->lease[i].expiry = expired;
+    }
+    d->leases_changed = false;
+}
+
+bool dhcp_server_export_leases(dhcp_server_t *d, uint8_t macs[DHCPS_MAX_IP][DHCPS_MAC_LEN]) {
+    for (int i = 0; i < DHCPS_MAX_IP; ++i) {
+        memcpy(macs[i], d->lease[i].mac, MAC_LEN);
+    }
+    bool changed = d->leases_changed;
+    d->leases_changed = false;
+    return changed;
+}
@@ -28,22 +28,36 @@
 
 #include "lwip/ip_addr.h"
 
+#include <stdbool.h>
+
 #define DHCPS_BASE_IP (16)
-#define DHCPS_MAX_IP (8)
+// Power of two, the home slot of a client is a hash of its MAC
+#define DHCPS_MAX_IP (32)
+#define DHCPS_MAC_LEN (6)
 
 typedef struct _dhcp_server_lease_t {
-    uint8_t mac[6];
+    uint8_t mac[DHCPS_MAC_LEN];
     uint16_t expiry;
 } dhcp_server_lease_t;
 
+// Lease i holds the address DHCPS_BASE_IP + i. An expired lease keeps its
+// MAC, so a returning client gets the same address unless it was reused
 typedef struct _dhcp_server_t {
     ip_addr_t ip;
     ip_addr_t nm;
     dhcp_server_lease_t lease[DHCPS_MAX_IP];
+    bool leases_changed; // A MAC was bound to a lease since the last export
     struct udp_pcb *udp;
 } dhcp_server_t;
 
+// The leases in d are kept, zero d or import leases before the first init
 void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm);
 void dhcp_server_deinit(dhcp_server_t *d);
+// Restores the MACs of the leases, e.g. saved before a reboot. They are
+// imported as expired
+void dhcp_server_import_leases(dhcp_server_t *d, const uint8_t macs[DHCPS_MAX_IP][DHCPS_MAC_LEN]);
+// Copies the MACs of the leases, returns true if they changed since the last
+// export
+bool dhcp_server_export_leases(dhcp_server_t *d, uint8_t macs[DHCPS_MAX_IP][DHCPS_MAC_LEN]);
 
 #endif // MICROPY_INCLUDED_LIB_NETUTILS_DHCPSERVER_H
@@ -30,6 +30,9 @@ typedef struct dns_header_t_ {
 
 #define MAX_DNS_MSG_SIZE 300
 
+// QR = response, AA = authoritative, RA = recursion available (rfc1035)
+#define DNS_REPLY_FLAGS PP_HTONS(0x1 << 15 | 0x1 << 10 | 0x1 << 7)
+
 static int dns_socket_new_dgram(struct udp_pcb **udp, void *cb_data, udp_recv_fn cb_udp_recv) {
     *udp = udp_new();
     if (*udp == NULL) {
@@ -176,36 +179,26 @@ static void dns_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
         goto ignore_request;
     }
 
+    // QTYPE and QCLASS must be there and the answer must fit behind them
+    if (question_ptr + 4 > question_ptr_end || question_ptr + 4 + DNS_ANSWER_SIZE > dns_msg + sizeof(dns_msg)) {
+        DEBUG_printf("Invalid question\n");
+        goto ignore_request;
+    }
+    bool host_address = question_ptr[0] == 0 && question_ptr[1] == 1;
+
     // Skip QNAME and QTYPE
     question_ptr += 4;
 
-    // Generate answer
+    // The answer is the prebuilt record, other types get an empty answer so
+    // clients do not wait for AAAA records
     uint8_t *answer_ptr = dns_msg + (question_ptr - dns_msg);
-    *answer_ptr++ = 0xc0; // pointer
-    *answer_ptr++ = question_ptr_start - dns_msg; // pointer to question
-    
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 1; // host address
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 1; // Internet class
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 60; // ttl 60s
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 4; // length
-    memcpy(answer_ptr, &d->ip.addr, 4); // use our address
-    answer_ptr += 4;
-
-    dns_hdr->flags = lwip_htons(
-                0x1 << 15 | // QR = response
-                0x1 << 10 | // AA = authoritative
-                0x1 << 7);   // RA = authenticated
+    if (host_address) {
+        memcpy(answer_ptr, d->answer, DNS_ANSWER_SIZE);
+        answer_ptr += DNS_ANSWER_SIZE;
+    }
+    dns_hdr->flags = DNS_REPLY_FLAGS;
     dns_hdr->question_count = lwip_htons(1);
-    dns_hdr->answer_record_count = lwip_htons(1);
+    dns_hdr->answer_record_count = host_address ? lwip_htons(1) : 0;
     dns_hdr->authority_record_count = 0;
     dns_hdr->additional_record_count = 0;
 
@@ -227,6 +220,27 @@ void dns_server_init(dns_server_t *d, ip_addr_t *ip) {
         return;
     }
     ip_addr_copy(d->ip, *ip);
+
+    // Every reply carries the same answer, it is built once
+    uint8_t *answer_ptr = d->answer;
+    *answer_ptr++ = 0xc0; // pointer
+    *answer_ptr++ = sizeof(dns_header_t); // pointer to question
+
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 1; // host address
+
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 1; // Internet class
+
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 60; // ttl 60s
+
+    *answer_ptr++ = 0;
+    *answer_ptr++ = 4; // length
+    memcpy(answer_ptr, &d->ip.addr, 4); // use our address
+
     DEBUG_printf("dns server listening on port %d\n", PORT_DNS_SERVER);
 }
 
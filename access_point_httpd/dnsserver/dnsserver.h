@@ -9,9 +9,13 @@
 
 #include "lwip/ip_addr.h"
 
+// Pointer to the question name, type, class, ttl, length and the address
+#define DNS_ANSWER_SIZE 16
+
 typedef struct dns_server_t_ {
     struct udp_pcb *udp;
      ip_addr_t ip;
+    uint8_t answer[DNS_ANSWER_SIZE]; // Answer record of every reply
 } dns_server_t;
 
 void dns_server_init(dns_server_t *d, ip_addr_t *ip);
@@ -0,0 +1,104 @@
+#include "form_parser.h"
+#include "utility.h"
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static void append(form_parser_t *parser, char c) {
+  if (parser->part == FORM_KEY) {
+    if (parser->key_len < FORM_MAX_KEY_LEN) {
+      parser->key[parser->key_len++] = c;
+      return;
+    }
+  } else if (parser->value_len < FORM_MAX_VALUE_LEN) {
+    parser->value[parser->value_len++] = c;
+    return;
+  }
+  parser->overflow = true;
+}
+
+/* A "%" not followed by two hex digits is kept as is */
+static void flush_escape(form_parser_t *parser) {
+  if (parser->escape > 0) {
+    append(parser, '%');
+  }
+  if (parser->escape > 1) {
+    append(parser, parser->digit);
+  }
+  parser->escape = 0;
+}
+
+static void emit_pair(form_parser_t *parser) {
+  flush_escape(parser);
+  parser->key[parser->key_len] = 0;
+  parser->value[parser->value_len] = 0;
+  if (parser->overflow) {
+    DEBUG_PRINT("POST field %s is too long, skipped\n", parser->key);
+  } else if (parser->key_len > 0) {
+    parser->field_fn(parser->key, parser->value);
+  }
+  parser->part = FORM_KEY;
+  parser->overflow = false;
+  parser->key_len = 0;
+  parser->value_len = 0;
+}
+
+void form_parser_init(form_parser_t *parser, form_field_fn field_fn) {
+  parser->field_fn = field_fn;
+  parser->part = FORM_KEY;
+  parser->escape = 0;
+  parser->overflow = false;
+  parser->key_len = 0;
+  parser->value_len = 0;
+}
+
+void form_parser_feed(form_parser_t *parser, const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    if (parser->escape == 1 && hex_value(c) >= 0) {
+      parser->digit = c;
+      parser->escape = 2;
+      continue;
+    }
+    if (parser->escape == 2 && hex_value(c) >= 0) {
+      append(parser, (char)(hex_value(parser->digit) << 4 | hex_value(c)));
+      parser->escape = 0;
+      continue;
+    }
+    // Not a hex digit, the char is parsed as usual after the broken escape
+    flush_escape(parser);
+    switch (c) {
+    case '&':
+      emit_pair(parser);
+      break;
+    case '=':
+      // Only the first "=" separates the value, an encoder escapes the others
+      if (parser->part == FORM_KEY) {
+        parser->part = FORM_VALUE;
+      } else {
+        append(parser, c);
+      }
+      break;
+    case '+':
+      append(parser, ' ');
+      break;
+    case '%':
+      parser->escape = 1;
+      break;
+    default:
+      append(parser, c);
+    }
+  }
+}
+
+void form_parser_finish(form_parser_t *parser) { emit_pair(parser); }
@@ -0,0 +1,68 @@
+/*
+ * Incremental parser of application/x-www-form-urlencoded bodies. The body is
+ * fed chunk by chunk as lwIP delivers it, a pair may be split at any byte
+ * between two chunks. Keys and values are URL-decoded ("+" and "%XX") while
+ * they are read, only the pair being parsed is kept in memory.
+ */
+#ifndef FORM_PARSER_H_SENTRY
+#define FORM_PARSER_H_SENTRY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Longest decoded key, longer keys are dropped with their value */
+#define FORM_MAX_KEY_LEN 32
+/* Longest decoded value, the largest settings field is 200 bytes */
+#define FORM_MAX_VALUE_LEN 200
+
+/**
+ * @brief Called for every decoded pair.
+ *
+ * @param[in] key   Null-terminated key.
+ * @param[in] value Null-terminated value, empty if the pair had no "=" or no
+ * value.
+ */
+typedef void (*form_field_fn)(const char *key, const char *value);
+
+typedef enum {
+  FORM_KEY,
+  FORM_VALUE,
+} form_part_t;
+
+typedef struct {
+  form_field_fn field_fn;
+  form_part_t part;
+  uint8_t escape; // Chars of "%XX" read so far, 0 outside of an escape
+  char digit;     // First hex digit of the escape as received
+  bool overflow;  // The pair is too long, it is skipped
+  uint16_t key_len;
+  uint16_t value_len;
+  char key[FORM_MAX_KEY_LEN + 1];
+  char value[FORM_MAX_VALUE_LEN + 1];
+} form_parser_t;
+
+/**
+ * @brief Prepares the parser for a new body.
+ *
+ * @param[out] parser   Parser to reset.
+ * @param[in]  field_fn Function receiving the decoded pairs.
+ */
+void form_parser_init(form_parser_t *parser, form_field_fn field_fn);
+/**
+ * @brief Parses the next chunk of the body, completed pairs are passed to the
+ * field function.
+ *
+ * @param[in,out] parser Parser.
+ * @param[in]     data   Chunk, not null-terminated.
+ * @param[in]     len    Length of the chunk.
+ */
+void form_parser_feed(form_parser_t *parser, const char *data, size_t len);
+/**
+ * @brief Passes the last pair of the body to the field function.
+ *
+ * @param[in,out] parser Parser.
+ */
+void form_parser_finish(form_parser_t *parser);
+
+#endif // FORM_PARSER_H_SENTRY
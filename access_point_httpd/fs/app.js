@@ -0,0 +1,50 @@
+// Sensor values are pushed over Server-Sent Events (port 8080), polling the
+// JSON endpoint is the fallback
+// Topic data are the JSON objects of the sensors, shown as "key: value" lists
+function format(value) {
+    if (value === null || typeof value !== 'object') return String(value);
+    return Object.keys(value).map(function (key) {
+        return key + ': ' + value[key];
+    }).join(', ');
+}
+
+function show(data) {
+    for (var key in data) {
+        var el = document.getElementById(key);
+        if (el) el.textContent = format(data[key]);
+    }
+}
+
+// SSI inserted the raw JSON of every topic
+var rows = document.querySelectorAll('.data-display span');
+for (var i = 0; i < rows.length; i++) {
+    try {
+        rows[i].textContent = format(JSON.parse(rows[i].textContent));
+    } catch (e) {}
+}
+
+function poll() {
+    setInterval(function () {
+        fetch('/api/sensors').then(function (r) { return r.json(); })
+            .then(show).catch(function () {});
+    }, 2000);
+}
+
+if (window.EventSource) {
+    var events = new EventSource('http://' + location.hostname + ':8080/events');
+    var received = false;
+    events.onmessage = function (e) {
+        received = true;
+        show(JSON.parse(e.data));
+    };
+    events.onerror = function () {
+        // Streams are limited, fall back to polling if refused. An open stream
+        // reconnects by itself
+        if (!received) {
+            events.close();
+            poll();
+        }
+    };
+} else {
+    poll();
+}
@@ -1,32 +1,45 @@
 #include "http_control.h"
+#include "form_parser.h"
 #include "utility.h"
 
 #include <lwip/apps/httpd.h>
 #include <lwip/def.h>
+#include <lwip/ip.h>
+#include <lwip/mem.h>
 
-// Buffer to store incoming POST data
-static char post_data_buffer[MAX_POST_DATA_LEN];
-static uint16_t post_data_index = 0;
+// Pairs are decoded as the body arrives, it is never stored as a whole
+static form_parser_t post_parser;
 static process_post_field_fn process_post_field_cb;
+static sensors_json_fn sensors_json_cb;
 static volatile bool *static_store_settings_flag = NULL;
+/* Requests are served only when received on this interface */
+static struct netif *portal_netif = NULL;
+/* Time-to-portal: from the portal start to the first request, usually the
+ * connectivity probe of the OS, and to the first load of the portal page */
+static struct {
+  absolute_time_t start;
+  bool first_request;
+  bool portal_page;
+} portal_timing;
+
+/* Called from tcp_input, so the interface the request arrived on is known.
+ * Data retried from the TCP timer has none and is refused as well */
+static bool from_portal() {
+  return portal_netif != NULL && ip_current_input_netif() == portal_netif;
+}
 
 // POST handler: called when a new POST request begins
 err_t httpd_post_begin(void *connection, const char *uri,
                        const char *http_request, uint16_t http_request_len,
                        int content_len, char *response_uri,
                        uint16_t response_uri_len, uint8_t *post_auto_wnd) {
-  DEBUG_PRINT("POST request received for URI: %s\n", uri);
-
-  // Check content length
-  if (content_len > MAX_POST_DATA_LEN) {
-    DEBUG_PRINT("POST content too large: %d bytes\n", content_len);
-    strncpy(response_uri, "/index.ssi",
-            response_uri_len); // Point to error page
+  DEBUG_PRINT("POST request received for URI: %s (%d bytes)\n", uri,
+              content_len);
+  if (!from_portal()) {
+    DEBUG_PRINT("POST refused, not received on the portal interface\n");
     return ERR_VAL;
   }
-
-  // Reset buffer and set the response URI
-  post_data_index = 0;
+  form_parser_init(&post_parser, process_post_field_cb);
   return ERR_OK;
 }
 
@@ -35,73 +48,136 @@ err_t httpd_post_receive_data(void *connection, struct pbuf *p) {
   if (!p)
     return ERR_ARG; // Ensure pbuf is valid
 
-  char *data = (char *)p->payload;
-  uint16_t len = p->len;
-
-  // Ensure buffer won't overflow
-  if (post_data_index + len > MAX_POST_DATA_LEN) {
-    DEBUG_PRINT("POST data buffer overflow!\n");
-    pbuf_free(p);
-    return ERR_MEM;
+  // Parse every pbuf of the chain in place
+  for (struct pbuf *q = p; q != NULL; q = q->next) {
+    form_parser_feed(&post_parser, (const char *)q->payload, q->len);
   }
 
-  // Append incoming data to the buffer
-  memcpy(&post_data_buffer[post_data_index], data, len);
-  post_data_index += len;
-
   pbuf_free(p); // Free the pbuf after processing
   return ERR_OK;
 }
 
-static void parse_buffer() {
-  uint16_t index_begin = 0, index_end = 0;
-  // Key-value are separted via "=", pairs are separted via "&"
-  char *token = strtok(post_data_buffer, "&");
-  char *key_value_sep;
-  while (token != NULL) {
-    // Loop to the end of the token, looking for "="
-    key_value_sep = token;
-    // Until null terminator set by strtok is met
-    while (*key_value_sep != 0) {
-      // HTTP changes "=" to %3D, so it will appear only as a control character
-      if (*key_value_sep == '=') {
-        // Set null term between key and value
-        *key_value_sep = 0;
-        if (*(key_value_sep + 1) != '0') {
-          process_post_field_cb(token, key_value_sep + 1);
-        } else {
-          process_post_field_cb(token, "");
-        }
-        break;
-      }
-      key_value_sep++;
-    }
-    token = strtok(NULL, "&");
-  }
-}
-
 // POST finished handler: called when all POST data has been received
 void httpd_post_finished(void *connection, char *response_uri,
                          uint16_t response_uri_len) {
-  DEBUG_PRINT("POST data received:\n%s\n", post_data_buffer);
-  parse_buffer();
+  form_parser_finish(&post_parser);
   *static_store_settings_flag = true;
   DEBUG_PRINT("POST processing complete. Sending response: %s\n", response_uri);
 
-  memset(post_data_buffer, 0, sizeof(post_data_buffer));
   strncpy(response_uri, "/index.ssi", response_uri_len);
 }
 
+/* Headers are included into the file, httpd sends the data as is */
+#define API_HEADER_SIZE 128
+
+static void log_portal_timing(const char *name) {
+  unsigned long elapsed_ms = (unsigned long)(
+      absolute_time_diff_us(portal_timing.start, get_absolute_time()) / 1000);
+  if (!portal_timing.first_request) {
+    portal_timing.first_request = true;
+    DEBUG_PRINT("First portal request %s after %lu ms\n", name, elapsed_ms);
+  }
+  if (!portal_timing.portal_page && strcmp(name, "/index.ssi") == 0) {
+    portal_timing.portal_page = true;
+    DEBUG_PRINT("Portal page opened after %lu ms\n", elapsed_ms);
+  }
+}
+
+/* Answer to requests from other interfaces, httpd has no deinit and keeps
+ * listening on the STA network after the portal stops */
+static const char refused_response[] = "HTTP/1.0 403 Forbidden\r\n"
+                                       "Content-Length: 0\r\n\r\n";
+/* Answer when no JSON snapshot could be produced */
+static const char error_response[] = "HTTP/1.0 500 Internal Server Error\r\n"
+                                     "Content-Length: 0\r\n\r\n";
+
+/* Serves a constant response, headers included */
+static int static_response(struct fs_file *file, const char *response,
+                           int len) {
+  file->data = response;
+  file->len = len;
+  file->index = file->len;
+  file->pextension = NULL;
+  file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+  return 1;
+}
+
+/* Called by httpd for every file before myfs.c is searched, so a request is
+ * refused here before any page, SSI tag or JSON snapshot is produced */
+int fs_open_custom(struct fs_file *file, const char *name) {
+  if (!from_portal()) {
+    DEBUG_PRINT("%s refused, not received on the portal interface\n", name);
+    return static_response(file, refused_response,
+                           sizeof(refused_response) - 1);
+  }
+  log_portal_timing(name);
+  if (strcmp(name, API_SENSORS_URI) != 0 || sensors_json_cb == NULL) {
+    return 0;
+  }
+  // Every connection gets its own snapshot, freed in fs_close_custom
+  char *buffer = mem_malloc(API_HEADER_SIZE + API_SENSORS_JSON_SIZE);
+  if (buffer == NULL) {
+    DEBUG_PRINT("No memory for %s\n", API_SENSORS_URI);
+    return static_response(file, error_response, sizeof(error_response) - 1);
+  }
+  char *body = buffer + API_HEADER_SIZE;
+  uint16_t body_len = sensors_json_cb(body, API_SENSORS_JSON_SIZE);
+  if (body_len == 0) {
+    DEBUG_PRINT("%s does not fit into %d bytes\n", API_SENSORS_URI,
+                (int)API_SENSORS_JSON_SIZE);
+    mem_free(buffer);
+    return static_response(file, error_response, sizeof(error_response) - 1);
+  }
+  int header_len = snprintf(buffer, API_HEADER_SIZE,
+                            "HTTP/1.0 200 OK\r\n"
+                            "Content-Type: application/json\r\n"
+                            "Cache-Control: no-store\r\n"
+                            "Content-Length: %u\r\n\r\n",
+                            body_len);
+  memmove(buffer + header_len, body, body_len);
+  file->data = buffer;
+  file->len = header_len + body_len;
+  file->index = file->len;
+  file->pextension = buffer;
+  file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+  return 1;
+}
+
+void fs_close_custom(struct fs_file *file) {
+  if (file->pextension != NULL) {
+    mem_free(file->pextension);
+    file->pextension = NULL;
+  }
+}
+
 int my_httpd_run(tSSIHandler my_ssi_handler, const char *ssitags[],
                  uint8_t number_of_tags,
                  process_post_field_fn process_post_field,
+                 sensors_json_fn sensors_json,
                  volatile bool *store_settings_flag) {
+  static bool started = false;
   process_post_field_cb = process_post_field;
+  sensors_json_cb = sensors_json;
   static_store_settings_flag = store_settings_flag;
-  cyw43_arch_lwip_begin();
-  http_set_ssi_handler(my_ssi_handler, ssitags, number_of_tags);
-  httpd_init();
-  cyw43_arch_lwip_end();
+  // httpd has no deinit, the listener is created once per boot
+  if (!started) {
+    cyw43_arch_lwip_begin();
+    http_set_ssi_handler(my_ssi_handler, ssitags, number_of_tags);
+    httpd_init();
+    cyw43_arch_lwip_end();
+    started = true;
+  }
 
   return 0;
 }
+
+void my_httpd_set_portal_netif(struct netif *netif) {
+  cyw43_arch_lwip_begin();
+  if (netif != NULL && portal_netif == NULL) {
+    portal_timing.start = get_absolute_time();
+    portal_timing.first_request = false;
+    portal_timing.portal_page = false;
+  }
+  portal_netif = netif;
+  cyw43_arch_lwip_end();
+}
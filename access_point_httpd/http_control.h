@@ -1,9 +1,11 @@
 #ifndef HTTP_CONTROL_H_SENTRY
 #define HTTP_CONTROL_H_SENTRY
 
+#include "lwip/apps/fs.h"
 #include "lwip/apps/httpd.h"
 #include "pico/stdlib.h"
 #include "runtime_settings.h"
+#include "sensors.h"
 #include "utility.h"
 #include <lwip/arch.h>
 #include <lwip/def.h>
@@ -12,10 +14,17 @@
 #include <stdio.h>
 #include <string.h>
 
-#define MAX_POST_DATA_LEN 1024
 #define MAX_URI_LEN 64
 
+/* URI of the JSON snapshot of the sensor values */
+#define API_SENSORS_URI "/api/sensors"
+/* Size of the JSON body, the data of every topic with its key */
+#define API_SENSORS_JSON_SIZE SENSORS_JSON_SIZE
+
 typedef void (*process_post_field_fn)(const char *key, const char *value);
+/* Writes the JSON snapshot into the buffer, returns its length or 0 if it does
+ * not fit. Called from the lwIP context */
+typedef uint16_t (*sensors_json_fn)(char *buffer, uint16_t size);
 /* Handler-functions required by LWIP HTTPD */
 // POST handler: called when a new POST request begins
 err_t httpd_post_begin(void *connection, const char *uri,
@@ -28,9 +37,19 @@ err_t httpd_post_receive_data(void *connection, struct pbuf *p);
 // POST finished handler: called when all POST data has been received
 void httpd_post_finished(void *connection, char *response_uri,
                          uint16_t response_uri_len);
+/* Files served by the callbacks instead of myfs.c */
+int fs_open_custom(struct fs_file *file, const char *name);
+void fs_close_custom(struct fs_file *file);
+/* Starts httpd on the first call, later calls only replace the POST and
+ * JSON callbacks */
 int my_httpd_run(tSSIHandler my_ssi_handler, const char *ssitags[],
                  uint8_t number_of_tags,
                  process_post_field_fn process_post_field,
+                 sensors_json_fn sensors_json,
                  volatile bool *store_settings_flag);
+/* httpd has no deinit and listens on every interface, files, SSI pages and
+ * settings are served only for requests received on netif. NULL refuses all
+ * of them */
+void my_httpd_set_portal_netif(struct netif *netif);
 
 #endif // HTTP_CONTROL_H_SENTRY
@@ -7,6 +7,7 @@
 #if PICO_CYW43_ARCH_POLL
 #define MEM_LIBC_MALLOC 1
 #else
+// lwIP runs from IRQ in threadsafe_background, libc malloc is not IRQ safe
 #define MEM_LIBC_MALLOC 0
 #endif
 
@@ -17,11 +18,20 @@
 
 // Enables POST support
 #define LWIP_HTTPD_SUPPORT_POST 1
-// Includes page
+// Includes pages, generated from fs/ by makefsdata.py during the build
 #define HTTPD_FSDATA_FILE "myfs.c"
+// Serves /api/sensors from http_control.c
+#define LWIP_HTTPD_CUSTOM_FILES 1
 
 #define MEM_ALIGNMENT 4
+#if PICO_CYW43_ARCH_POLL
 #define MEM_SIZE 4000
+#else
+// lwIP heap holds altcp TLS state and httpd connections without libc malloc
+#define MEM_SIZE 16000
+#endif
+// httpd connections and SSE_MAX_STREAMS streams in AP mode
+#define MEMP_NUM_TCP_PCB 8
 #define MEMP_NUM_TCP_SEG 32
 #define MEMP_NUM_ARP_QUEUE 10
 #define PBUF_POOL_SIZE 24
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""Converts the files of access_point_httpd/fs into myfs.c for lwIP httpd.
+
+Replaces the makefsdata (htmlgen) binary, the output has the same layout.
+HTML and CSS are minified. Static files are stored gzip-precompressed with
+"Content-Encoding: gzip" if that is smaller; SSI files stay uncompressed as
+httpd parses their tags while sending.
+
+If the settings schema (settings_schema.h) is given, <!--@settings_form--> in
+the pages is replaced with an input for every settings field. If the sensor
+registry (sensors_registry.h) is given, <!--@sensor_rows--> is replaced with a
+row showing the SSI tag of every enabled sensor.
+
+The connectivity probes of phones and laptops (CAPTIVE_PROBES) get a prebuilt
+redirect to the portal page, as does every unknown URI through /404.html. The
+probes are put at the head of the file list, httpd finds them first.
+
+Usage: makefsdata.py <fs directory> <output file> [settings schema
+       [sensor registry]]
+"""
+
+import gzip
+import html
+import os
+import re
+import sys
+
+SERVER = "lwIP/2.2.0 (http://savannah.nongnu.org/projects/lwip)"
+SSI_EXTENSIONS = (".ssi", ".shtml", ".shtm")
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".ssi": "text/html",
+    ".shtml": "text/html",
+    ".shtm": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".svg": "image/svg+xml",
+}
+
+
+# Address of the AP set in portal_start() of main.c
+PORTAL_URL = "http://192.168.4.1/index.ssi"
+# URIs requested by the OS after joining a network, anything but the expected
+# answer opens the captive portal window
+CAPTIVE_PROBES = (
+    "/generate_204",  # Android, ChromeOS
+    "/gen_204",  # Android
+    "/hotspot-detect.html",  # iOS, macOS
+    "/library/test/success.html",  # Older iOS
+    "/connecttest.txt",  # Windows 10 and later
+    "/ncsi.txt",  # Older Windows
+    "/redirect",  # Windows, after connecttest.txt
+    "/canonical.html",  # Firefox
+    "/success.txt",  # Firefox
+    "/404.html",  # Sent by httpd for unknown URIs
+)
+
+
+SETTINGS_FORM = "<!--@settings_form-->"
+SCHEMA_ENTRY = re.compile(
+    r'X\((\w+),\s*(\d+),\s*\w+,\s*"(\w+)",\s*"([^"]*)"\)')
+
+
+def settings_form(schema_path):
+    """Returns a label and an input for every entry of the schema."""
+    with open(schema_path) as f:
+        entries = SCHEMA_ENTRY.findall(f.read())
+    if not entries:
+        sys.exit("No settings fields found in " + schema_path)
+    rows = []
+    for name, size, kind, label in entries:
+        label = html.escape(label)
+        attributes = 'type="password"' if kind == "password" else 'type="text"'
+        if kind == "number":
+            attributes += ' inputmode="numeric" pattern="[0-9]*"'
+        rows.append('<label for="%s">%s:</label>\n'
+                    '<input %s id="%s" name="%s" '
+                    'placeholder="Enter %s (optional)" maxlength="%d">\n' %
+                    (name, label, attributes, name, name, label,
+                     int(size) - 1))
+    return "".join(rows)
+
+
+SENSOR_ROWS = "<!--@sensor_rows-->"
+REGISTRY_ENTRY = re.compile(r'X\((\w+),\s*\w+,\s*([01]),\s*"([^"]*)"\)')
+
+
+def sensor_rows(registry_path):
+    """Returns a row with the SSI tag for every enabled sensor."""
+    with open(registry_path) as f:
+        entries = REGISTRY_ENTRY.findall(f.read())
+    if not entries:
+        sys.exit("No sensors found in " + registry_path)
+    return "".join('<p><strong>%s:</strong> <span id="%s"><!--#%s--></span>'
+                   '</p>\n' % (html.escape(label), topic, topic)
+                   for topic, enabled, label in entries if enabled == "1")
+
+
+def strip_css_comments(text):
+    return re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+
+
+def minify(path, text):
+    """Drops comments, indentation and empty lines. Line breaks are kept, so
+    inline scripts with line comments stay valid."""
+    ext = os.path.splitext(path)[1]
+    if ext == ".css":
+        text = strip_css_comments(text)
+    elif ext in (".html", ".htm") + SSI_EXTENSIONS:
+        # SSI tags <!--#tag--> are comments too, they must stay
+        text = re.sub(r"<!--(?!#).*?-->", "", text, flags=re.S)
+        text = re.sub(r"<style>.*?</style>",
+                      lambda m: strip_css_comments(m.group(0)), text,
+                      flags=re.S)
+    elif ext != ".js":
+        return text
+    lines = (line.strip() for line in text.splitlines())
+    if ext == ".js":
+        lines = (line for line in lines if not line.startswith("//"))
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def http_header(path, length, encoding):
+    ext = os.path.splitext(path)[1]
+    lines = ["HTTP/1.0 200 OK", "Server: " + SERVER]
+    if length is not None:
+        lines.append("Content-Length: %d" % length)
+    if encoding:
+        lines.append("Content-Encoding: " + encoding)
+    lines.append("Content-Type: " + CONTENT_TYPES.get(ext, "text/plain"))
+    if ext in SSI_EXTENSIONS:
+        # Sensor values change on every request
+        lines += ["Expires: Fri, 10 Apr 2008 14:00:00 GMT", "Pragma: no-cache"]
+    else:
+        lines.append("Cache-Control: max-age=86400")
+    return "".join(line + "\r\n" for line in lines) + "\r\n"
+
+
+def c_bytes(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("".join("0x%02x," % b for b in data[i:i + 16]))
+    return "\n".join(rows) + "\n"
+
+
+def c_name(uri):
+    return re.sub(r"[^A-Za-z0-9]", "_", uri)
+
+
+def fsdata_entry(uri, header, data, comment, flags):
+    """Returns the C array of a file, its name and the length of the name."""
+    name_bytes = uri.encode("utf-8") + b"\0"
+    # The name is padded to keep the header and data 4 byte aligned
+    name_bytes += b"\0" * (-len(name_bytes) % 4)
+    name = c_name(uri)
+    out = []
+    out.append("#if FSDATA_FILE_ALIGNMENT==1\n")
+    out.append("static const unsigned int dummy_align_%s = 0;\n" % name)
+    out.append("#endif\n")
+    out.append("static const unsigned char FSDATA_ALIGN_PRE data_%s[] "
+               "FSDATA_ALIGN_POST = {\n" % name)
+    out.append("/* %s (%d chars) */\n" % (uri, len(uri) + 1))
+    out.append(c_bytes(name_bytes))
+    out.append("\n/* HTTP header */\n")
+    out.append("/* %d bytes */\n" % len(header))
+    out.append(c_bytes(header.encode("ascii")))
+    if data:
+        out.append("/* %s */\n" % comment)
+        out.append(c_bytes(data))
+    out.append("};\n\n")
+    return name, len(name_bytes), "".join(out), flags
+
+
+def probe_redirect(uri):
+    """Returns the entry of a connectivity probe, a redirect without a body.
+    The redirect must not be cached, the OS probes again on other networks."""
+    header = ("HTTP/1.0 302 Found\r\n"
+              "Server: %s\r\n"
+              "Location: %s\r\n"
+              "Content-Length: 0\r\n"
+              "Cache-Control: no-store\r\n\r\n" % (SERVER, PORTAL_URL))
+    return fsdata_entry(uri, header, b"", None,
+                        "FS_FILE_FLAGS_HEADER_INCLUDED")
+
+
+def convert(root, path, generated):
+    uri = "/" + os.path.relpath(path, root).replace(os.sep, "/")
+    with open(path, "rb") as f:
+        raw = f.read()
+    ext = os.path.splitext(path)[1]
+    ssi = ext in SSI_EXTENSIONS
+    if ext in CONTENT_TYPES and not CONTENT_TYPES[ext].startswith("image/"):
+        text = raw.decode("utf-8")
+        for marker, content in generated.items():
+            if marker not in text:
+                continue
+            if content is None:
+                sys.exit("%s has %s, its source is missing" % (path, marker))
+            text = text.replace(marker, content)
+        raw = minify(path, text).encode("utf-8")
+    encoding = None
+    data = raw
+    if not ssi:
+        # mtime=0 keeps the output identical between builds
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        if len(packed) < len(raw):
+            data, encoding = packed, "gzip"
+    # SSI output length is not known before the tags are replaced
+    header = http_header(path, None if ssi else len(data), encoding)
+    flags = "FS_FILE_FLAGS_HEADER_INCLUDED"
+    if ssi:
+        flags += " | FS_FILE_FLAGS_SSI"
+    comment = "%s file data (%d bytes, %d before)" % (
+        "gzip" if encoding else "raw", len(data), len(raw))
+    return fsdata_entry(uri, header, data, comment, flags)
+
+
+def main():
+    if len(sys.argv) not in (3, 4, 5):
+        sys.exit(__doc__)
+    root, output = sys.argv[1], sys.argv[2]
+    generated = {
+        SETTINGS_FORM: settings_form(sys.argv[3]) if len(sys.argv) > 3
+        else None,
+        SENSOR_ROWS: sensor_rows(sys.argv[4]) if len(sys.argv) > 4 else None,
+    }
+    paths = []
+    for directory, _, files in os.walk(root):
+        paths += [os.path.join(directory, f) for f in files]
+    paths.sort()
+    files = [convert(root, path, generated) for path in paths]
+    # The list is built backwards, the probes end up at its head
+    files += [probe_redirect(uri) for uri in CAPTIVE_PROBES]
+
+    text = ['#include "lwip/apps/fs.h"\n#include "lwip/def.h"\n\n',
+            "/* Generated by makefsdata.py from %s, do not edit */\n\n" %
+            os.path.basename(os.path.normpath(root)),
+            "#define file_NULL (struct fsdata_file *) NULL\n\n",
+            "#ifndef FS_FILE_FLAGS_HEADER_INCLUDED\n"
+            "#define FS_FILE_FLAGS_HEADER_INCLUDED 1\n#endif\n",
+            "#ifndef FS_FILE_FLAGS_HEADER_PERSISTENT\n"
+            "#define FS_FILE_FLAGS_HEADER_PERSISTENT 0\n#endif\n",
+            "/* FSDATA_FILE_ALIGNMENT: 0=off, 1=by variable, 2=by include */\n"
+            "#ifndef FSDATA_FILE_ALIGNMENT\n#define FSDATA_FILE_ALIGNMENT 0\n"
+            "#endif\n#ifndef FSDATA_ALIGN_PRE\n#define FSDATA_ALIGN_PRE\n"
+            "#endif\n#ifndef FSDATA_ALIGN_POST\n#define FSDATA_ALIGN_POST\n"
+            "#endif\n#if FSDATA_FILE_ALIGNMENT==2\n"
+            '#include "fsdata_alignment.h"\n#endif\n']
+    text += [body for _, _, body, _ in files]
+    previous = "file_NULL"
+    for name, name_len, _, flags in files:
+        text.append("const struct fsdata_file file_%s[] = { {\n"
+                    "%s,\ndata_%s,\ndata_%s + %d,\n"
+                    "sizeof(data_%s) - %d,\n%s,\n}};\n\n" %
+                    (name, previous, name, name, name_len, name, name_len,
+                     flags))
+        previous = "file_" + name
+    text.append("#define FS_ROOT %s\n#define FS_NUMFILES %d\n" %
+                (previous, len(files)))
+
+    with open(output, "w") as f:
+        f.write("".join(text))
+
+
+if __name__ == "__main__":
+    main()
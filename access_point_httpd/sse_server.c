@@ -0,0 +1,219 @@
+#include "sse_server.h"
+#include "utility.h"
+
+#include <lwip/pbuf.h>
+#include <lwip/tcp.h>
+#include <stdio.h>
+#include <string.h>
+
+/* tcp_poll interval is in units of the coarse TCP timer (500 ms) */
+#define SSE_POLL_INTERVAL 4
+#define SSE_KEEPALIVE_POLLS (SSE_KEEPALIVE_S * 2 / SSE_POLL_INTERVAL)
+
+static const char sse_response[] = "HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: text/event-stream\r\n"
+                                   "Cache-Control: no-cache\r\n"
+                                   "Access-Control-Allow-Origin: *\r\n"
+                                   "Connection: keep-alive\r\n\r\n";
+
+typedef struct {
+  struct tcp_pcb *pcb;
+  uint8_t header_match; // Matched chars of the end of the request header
+  bool streaming;       // Response header is sent
+  uint8_t idle_polls;
+  uint32_t sent_version[SSE_MAX_TOPICS];
+} sse_stream_t;
+
+static struct {
+  struct tcp_pcb *listen_pcb;
+  const char **topics;
+  uint8_t topic_count;
+  sse_topic_fn topic_fn;
+  sse_stream_t streams[SSE_MAX_STREAMS];
+} sse;
+
+/* Returns ERR_ABRT if the pcb had to be aborted, lwIP callbacks must pass it
+ * on */
+static err_t stream_close(sse_stream_t *stream) {
+  err_t err = ERR_OK;
+  if (stream->pcb == NULL) {
+    return err;
+  }
+  tcp_arg(stream->pcb, NULL);
+  tcp_recv(stream->pcb, NULL);
+  tcp_sent(stream->pcb, NULL);
+  tcp_err(stream->pcb, NULL);
+  tcp_poll(stream->pcb, NULL, 0);
+  if (tcp_close(stream->pcb) != ERR_OK) {
+    tcp_abort(stream->pcb);
+    err = ERR_ABRT;
+  }
+  stream->pcb = NULL;
+  return err;
+}
+
+/* Sends the topics changed since the last event, as long as the send buffer
+ * has space. Skipped topics are sent with their newest data later */
+static void stream_push(sse_stream_t *stream) {
+  char event[SSE_EVENT_SIZE];
+  bool written = false;
+  for (uint8_t i = 0; i < sse.topic_count; i++) {
+    uint32_t version;
+    const char *data = sse.topic_fn(i, &version);
+    if (version == stream->sent_version[i]) {
+      continue;
+    }
+    int len = snprintf(event, sizeof(event), "data: {\"%s\":%s}\n\n",
+                       sse.topics[i], data);
+    if (len < 0 || len >= (int)sizeof(event)) {
+      DEBUG_PRINT("SSE event of %s is too long\n", sse.topics[i]);
+      stream->sent_version[i] = version;
+      continue;
+    }
+    if (tcp_sndbuf(stream->pcb) < len ||
+        tcp_write(stream->pcb, event, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      break;
+    }
+    stream->sent_version[i] = version;
+    written = true;
+  }
+  if (written) {
+    stream->idle_polls = 0;
+    tcp_output(stream->pcb);
+  }
+}
+
+static err_t stream_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+  sse_stream_t *stream = (sse_stream_t *)arg;
+  // The send buffer drained, skipped topics fit now
+  if (stream->streaming) {
+    stream_push(stream);
+  }
+  return ERR_OK;
+}
+
+static err_t stream_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                         err_t err) {
+  sse_stream_t *stream = (sse_stream_t *)arg;
+  if (p == NULL) {
+    return stream_close(stream);
+  }
+  // The request is not parsed, any GET opens the stream
+  static const char header_end[] = "\r\n\r\n";
+  for (uint16_t i = 0; i < p->tot_len && !stream->streaming; i++) {
+    char c = pbuf_get_at(p, i);
+    if (c == header_end[stream->header_match]) {
+      stream->header_match++;
+    } else {
+      stream->header_match = c == '\r';
+    }
+    if (stream->header_match == sizeof(header_end) - 1) {
+      if (tcp_write(pcb, sse_response, sizeof(sse_response) - 1, 0) !=
+          ERR_OK) {
+        pbuf_free(p);
+        return stream_close(stream);
+      }
+      stream->streaming = true;
+      stream_push(stream);
+    }
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t stream_poll(void *arg, struct tcp_pcb *pcb) {
+  sse_stream_t *stream = (sse_stream_t *)arg;
+  if (!stream->streaming) {
+    // The request header did not arrive in time
+    return stream_close(stream);
+  }
+  if (++stream->idle_polls >= SSE_KEEPALIVE_POLLS &&
+      tcp_sndbuf(pcb) > 2 && tcp_write(pcb, ":\n\n", 3, 0) == ERR_OK) {
+    stream->idle_polls = 0;
+    tcp_output(pcb);
+  }
+  return ERR_OK;
+}
+
+static void stream_err(void *arg, err_t err) {
+  sse_stream_t *stream = (sse_stream_t *)arg;
+  DEBUG_PRINT("SSE stream error: %d\n", err);
+  // The pcb is already freed by lwIP
+  stream->pcb = NULL;
+}
+
+static err_t sse_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
+  if (err != ERR_OK || pcb == NULL) {
+    return ERR_VAL;
+  }
+  sse_stream_t *stream = NULL;
+  for (uint8_t i = 0; i < SSE_MAX_STREAMS; i++) {
+    if (sse.streams[i].pcb == NULL) {
+      stream = &sse.streams[i];
+      break;
+    }
+  }
+  if (stream == NULL) {
+    DEBUG_PRINT("SSE stream refused, %d streams open\n", SSE_MAX_STREAMS);
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  memset(stream, 0, sizeof(sse_stream_t));
+  stream->pcb = pcb;
+  tcp_arg(pcb, stream);
+  tcp_recv(pcb, stream_recv);
+  tcp_sent(pcb, stream_sent);
+  tcp_err(pcb, stream_err);
+  tcp_poll(pcb, stream_poll, SSE_POLL_INTERVAL);
+  return ERR_OK;
+}
+
+err_t sse_server_init(const char *topics[], uint8_t topic_count,
+                      sse_topic_fn topic_fn, struct netif *netif) {
+  if (topic_count > SSE_MAX_TOPICS) {
+    return ERR_ARG;
+  }
+  memset(&sse, 0, sizeof(sse));
+  sse.topics = topics;
+  sse.topic_count = topic_count;
+  sse.topic_fn = topic_fn;
+  struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+  if (pcb == NULL) {
+    return ERR_MEM;
+  }
+  err_t err = tcp_bind(pcb, IP_ANY_TYPE, SSE_PORT);
+  if (err != ERR_OK) {
+    tcp_close(pcb);
+    return err;
+  }
+  if (netif != NULL) {
+    tcp_bind_netif(pcb, netif);
+  }
+  sse.listen_pcb = tcp_listen_with_backlog(pcb, 1);
+  if (sse.listen_pcb == NULL) {
+    tcp_close(pcb);
+    return ERR_MEM;
+  }
+  tcp_accept(sse.listen_pcb, sse_accept);
+  DEBUG_PRINT("SSE server listening on port %d\n", SSE_PORT);
+  return ERR_OK;
+}
+
+void sse_server_service() {
+  for (uint8_t i = 0; i < SSE_MAX_STREAMS; i++) {
+    if (sse.streams[i].pcb != NULL && sse.streams[i].streaming) {
+      stream_push(&sse.streams[i]);
+    }
+  }
+}
+
+void sse_server_deinit() {
+  for (uint8_t i = 0; i < SSE_MAX_STREAMS; i++) {
+    stream_close(&sse.streams[i]);
+  }
+  if (sse.listen_pcb != NULL) {
+    tcp_close(sse.listen_pcb);
+    sse.listen_pcb = NULL;
+  }
+}
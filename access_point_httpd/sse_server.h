@@ -0,0 +1,67 @@
+/*
+ * Server-Sent Events stream of the sensor values for the AP mode page. lwIP
+ * httpd closes a connection once a file is sent, so the stream is served by a
+ * raw TCP listener on its own port. The net core loop calls
+ * sse_server_service(), every stream receives the topics whose version changed
+ * since its last event. A stream without space in the TCP send buffer is
+ * skipped and gets only the newest value once the buffer drains.
+ */
+#ifndef SSE_SERVER_H_SENTRY
+#define SSE_SERVER_H_SENTRY
+
+#include <lwip/err.h>
+#include <lwip/netif.h>
+#include <pico/stdlib.h>
+#include <stdint.h>
+
+/* Port of the stream, the page opens http://<host>:SSE_PORT/events */
+#define SSE_PORT 8080
+/* Maximum number of concurrent streams, further connections are refused */
+#define SSE_MAX_STREAMS 2
+/* Maximum number of topics tracked per stream */
+#define SSE_MAX_TOPICS 8
+/* Size of a single event: the topic name and its JSON data */
+#define SSE_EVENT_SIZE 160
+/* Streams without events get a comment this often to detect dead clients */
+#define SSE_KEEPALIVE_S 10
+
+/**
+ * @brief Returns the current data of a topic.
+ *
+ * @param[in]  index   Index of the topic.
+ * @param[out] version Version of the data, incremented on every update. `0`
+ * means no data yet.
+ *
+ * @return JSON data of the topic.
+ */
+typedef const char *(*sse_topic_fn)(uint8_t index, uint32_t *version);
+
+/**
+ * @brief Starts listening for streams.
+ *
+ * @param[in] topics      Names of the topics, used as the JSON keys.
+ * @param[in] topic_count Number of the topics, at most SSE_MAX_TOPICS.
+ * @param[in] topic_fn    Function returning the data of a topic.
+ * @param[in] netif       Interface to accept streams on, NULL for all.
+ *
+ * @return `ERR_OK` on success, lwIP error otherwise.
+ *
+ * @note Must be called from the lwIP context.
+ */
+err_t sse_server_init(const char *topics[], uint8_t topic_count,
+                      sse_topic_fn topic_fn, struct netif *netif);
+/**
+ * @brief Sends the changed topics to every stream that has space in its TCP
+ * send buffer.
+ *
+ * @note Must be called from the lwIP context.
+ */
+void sse_server_service();
+/**
+ * @brief Closes all streams and the listener.
+ *
+ * @note Must be called from the lwIP context.
+ */
+void sse_server_deinit();
+
+#endif // SSE_SERVER_H_SENTRY
@@ -0,0 +1,237 @@
+#include "adc_sampler.h"
+#include "utility.h"
+
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <pico/mutex.h>
+
+/* The ADC converts in 96 cycles of its 48 MHz clock */
+#define ADC_CLOCK_HZ 48000000
+
+static struct {
+  uint8_t input_mask;
+  uint8_t input_count;
+  bool running; // The DMA channels are claimed
+  uint data_chan;
+  uint control_chan;
+  absolute_time_t filled_at; // The window of every input holds samples
+  /* Round-robin order: sample i is of the (i % input_count)th enabled input
+   * counted from input 0 */
+  uint16_t ring[ADC_SAMPLER_SAMPLES_PER_INPUT * ADC_SAMPLER_INPUTS];
+  /* Read by the control channel to restart the data channel */
+  uint16_t *ring_start;
+} sampler;
+/* Samples of a burst, the first half is dropped as the input settles */
+static uint16_t burst[2 * ADC_SAMPLER_SAMPLES_PER_INPUT];
+/* The sensor core samples, the net core bursts VSYS */
+auto_init_mutex(sampler_mutex);
+
+static void sampler_stop() {
+  if (!sampler.running) {
+    return;
+  }
+  sampler.running = false;
+  adc_run(false);
+  // A chain trigger of the data channel could restart it during the abort
+  dma_channel_config control = dma_get_channel_config(sampler.control_chan);
+  channel_config_set_enable(&control, false);
+  dma_channel_set_config(sampler.control_chan, &control, false);
+  dma_channel_abort(sampler.control_chan);
+  dma_channel_abort(sampler.data_chan);
+  dma_channel_unclaim(sampler.control_chan);
+  dma_channel_unclaim(sampler.data_chan);
+  adc_set_round_robin(0);
+  adc_fifo_setup(false, false, 0, false, false);
+  adc_fifo_drain();
+}
+
+/* Starts the sampling of the enabled inputs, false if there are no free DMA
+ * channels for it */
+static bool sampler_start() {
+  int data_chan = dma_claim_unused_channel(false);
+  int control_chan = data_chan < 0 ? -1 : dma_claim_unused_channel(false);
+  if (control_chan < 0) {
+    if (data_chan >= 0) {
+      dma_channel_unclaim(data_chan);
+    }
+    return false;
+  }
+  sampler.data_chan = data_chan;
+  sampler.control_chan = control_chan;
+  sampler.running = true;
+
+  uint first_input = 0;
+  while (!(sampler.input_mask & (1u << first_input))) {
+    first_input++;
+  }
+  uint16_t ring_len = ADC_SAMPLER_SAMPLES_PER_INPUT * sampler.input_count;
+
+  adc_init();
+  adc_set_temp_sensor_enabled(sampler.input_mask &
+                              (1u << ADC_SAMPLER_TEMPERATURE_INPUT));
+  // Round robin goes up from the selected input, as the ring is ordered
+  adc_select_input(first_input);
+  adc_set_round_robin(sampler.input_mask);
+  // A DREQ for every sample, the result without the error flag
+  adc_fifo_setup(true, true, 1, false, false);
+  adc_set_clkdiv(ADC_CLOCK_HZ / ADC_SAMPLER_RATE_HZ - 1);
+
+  sampler.ring_start = sampler.ring;
+
+  dma_channel_config data = dma_channel_get_default_config(sampler.data_chan);
+  channel_config_set_transfer_data_size(&data, DMA_SIZE_16);
+  channel_config_set_read_increment(&data, false);
+  channel_config_set_write_increment(&data, true);
+  channel_config_set_dreq(&data, DREQ_ADC);
+  channel_config_set_chain_to(&data, sampler.control_chan);
+  dma_channel_configure(sampler.data_chan, &data, sampler.ring, &adc_hw->fifo,
+                        ring_len, false);
+
+  // Rewriting the write address with the trigger alias restarts the ring
+  dma_channel_config control =
+      dma_channel_get_default_config(sampler.control_chan);
+  channel_config_set_transfer_data_size(&control, DMA_SIZE_32);
+  channel_config_set_read_increment(&control, false);
+  channel_config_set_write_increment(&control, false);
+  dma_channel_configure(sampler.control_chan, &control,
+                        &dma_hw->ch[sampler.data_chan].al2_write_addr_trig,
+                        &sampler.ring_start, 1, true);
+
+  adc_run(true);
+  DEBUG_PRINT("ADC sampling inputs 0x%02x, %u samples per ring\n",
+              sampler.input_mask, ring_len);
+  return true;
+}
+
+/* Samples the inputs of the mask from now on, false if the sampling could
+ * not be started */
+static bool sampler_restart(uint8_t input_mask) {
+  sampler_stop();
+  sampler.input_mask = input_mask;
+  sampler.input_count = 0;
+  for (uint i = 0; i < ADC_SAMPLER_INPUTS; i++) {
+    sampler.input_count += (input_mask >> i) & 1;
+  }
+  if (sampler.input_count == 0) {
+    return true;
+  }
+  if (!sampler_start()) {
+    return false;
+  }
+  sampler.filled_at = make_timeout_time_us(
+      sampler.input_count * ADC_SAMPLER_SAMPLES_PER_INPUT *
+      (1000000ull / ADC_SAMPLER_RATE_HZ));
+  return true;
+}
+
+int adc_sampler_enable(uint input) {
+  if (input >= ADC_SAMPLER_INPUTS) {
+    return -1;
+  }
+  int result = 0;
+  mutex_enter_blocking(&sampler_mutex);
+  if (!(sampler.input_mask & (1u << input))) {
+    if (input != ADC_SAMPLER_TEMPERATURE_INPUT) {
+      adc_gpio_init(26 + input);
+    }
+    if (!sampler_restart(sampler.input_mask | (1u << input))) {
+      DEBUG_PRINT("No free DMA channels to sample ADC input %u\n", input);
+      // The inputs sampled before go on without it
+      sampler_restart(sampler.input_mask & ~(1u << input));
+      result = -2;
+    }
+  }
+  mutex_exit(&sampler_mutex);
+  return result;
+}
+
+void adc_sampler_disable(uint input) {
+  mutex_enter_blocking(&sampler_mutex);
+  if (input < ADC_SAMPLER_INPUTS && (sampler.input_mask & (1u << input))) {
+    sampler_restart(sampler.input_mask & ~(1u << input));
+  }
+  mutex_exit(&sampler_mutex);
+}
+
+int adc_sampler_read(uint input, float *raw) {
+  if (input >= ADC_SAMPLER_INPUTS) {
+    return -1;
+  }
+  mutex_enter_blocking(&sampler_mutex);
+  if (!(sampler.input_mask & (1u << input)) || !sampler.running ||
+      absolute_time_diff_us(get_absolute_time(), sampler.filled_at) > 0) {
+    mutex_exit(&sampler_mutex);
+    return -1;
+  }
+  // Position of the input in the round-robin order
+  uint position = 0;
+  for (uint i = 0; i < input; i++) {
+    position += (sampler.input_mask >> i) & 1;
+  }
+  // DMA keeps writing, every sample read is at most one ring old
+  uint ring_len = ADC_SAMPLER_SAMPLES_PER_INPUT * sampler.input_count;
+  uint32_t sum = 0;
+  for (uint i = position; i < ring_len; i += sampler.input_count) {
+    sum += sampler.ring[i];
+  }
+  mutex_exit(&sampler_mutex);
+  *raw = (float)sum / ADC_SAMPLER_SAMPLES_PER_INPUT;
+  return 0;
+}
+
+int adc_sampler_burst(uint input, float *raw) {
+  if (input >= ADC_SAMPLER_INPUTS) {
+    return -1;
+  }
+  mutex_enter_blocking(&sampler_mutex);
+  // The ring keeps its samples, the restart overwrites them in order
+  bool was_running = sampler.running;
+  sampler_stop();
+  int result = 0;
+  uint32_t sum = 0;
+  int chan = dma_claim_unused_channel(false);
+  if (chan < 0) {
+    DEBUG_PRINT("No free DMA channel for the ADC burst\n");
+    result = -2;
+  } else {
+    adc_init();
+    if (input != ADC_SAMPLER_TEMPERATURE_INPUT) {
+      adc_gpio_init(26 + input);
+    }
+    adc_set_temp_sensor_enabled(input == ADC_SAMPLER_TEMPERATURE_INPUT);
+    adc_select_input(input);
+    adc_fifo_setup(true, true, 1, false, false);
+    // Back-to-back conversions
+    adc_set_clkdiv(0);
+
+    dma_channel_config config = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(chan, &config, burst, &adc_hw->fifo,
+                          ARRAY_LENGTH(burst), true);
+    adc_run(true);
+    dma_channel_wait_for_finish_blocking(chan);
+    adc_run(false);
+    dma_channel_unclaim(chan);
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_fifo_drain();
+
+    for (uint i = ADC_SAMPLER_SAMPLES_PER_INPUT; i < ARRAY_LENGTH(burst);
+         i++) {
+      sum += burst[i];
+    }
+  }
+  // A sampling stopped for lack of DMA channels starts with a new window
+  if (sampler.input_count > 0 &&
+      !(was_running ? sampler_start() : sampler_restart(sampler.input_mask))) {
+    DEBUG_PRINT("No free DMA channels to restart the ADC sampling\n");
+    result = -2;
+  }
+  mutex_exit(&sampler_mutex);
+  if (result == 0) {
+    *raw = (float)sum / ADC_SAMPLER_SAMPLES_PER_INPUT;
+  }
+  return result;
+}
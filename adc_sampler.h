@@ -0,0 +1,73 @@
+/*
+ * Free-running ADC sampler. The enabled inputs are converted round-robin and
+ * DMA writes every result into a ring buffer, restarted by a second chained
+ * DMA channel, so raw samples cost no CPU time. A read decimates the last
+ * ADC_SAMPLER_SAMPLES_PER_INPUT samples of an input into their mean. Inputs
+ * that cannot be sampled continuously are read by a DMA burst. The functions
+ * are safe to call from both cores.
+ */
+#ifndef ADC_SAMPLER_H_SENTRY
+#define ADC_SAMPLER_H_SENTRY
+
+#include <pico/stdlib.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ADC inputs 0-3 are GPIO 26-29, 4 is the temperature sensor */
+#define ADC_SAMPLER_INPUTS 5
+#define ADC_SAMPLER_TEMPERATURE_INPUT 4
+/* Samples of an input averaged by a read */
+#define ADC_SAMPLER_SAMPLES_PER_INPUT 64
+/* Conversions per second over all enabled inputs */
+#define ADC_SAMPLER_RATE_HZ 1000
+
+/**
+ * @brief Adds an input to the sampled ones, the sampling restarts with it.
+ *
+ * @param[in] input ADC input 0-4, the GPIO of inputs 0-3 is set to analog.
+ * @return 0 on success, -1 if the input is invalid, -2 if there are no free
+ * DMA channels for the sampling. The inputs sampled before go on then.
+ */
+int adc_sampler_enable(uint input);
+/**
+ * @brief Removes an input from the sampled ones, the sampling stops with the
+ * last one and its DMA channels are released.
+ *
+ * @param[in] input ADC input 0-4.
+ */
+void adc_sampler_disable(uint input);
+/**
+ * @brief Reads the mean of the last ADC_SAMPLER_SAMPLES_PER_INPUT samples of
+ * an input.
+ *
+ * @param[in]  input ADC input 0-4.
+ * @param[out] raw   Mean in 12-bit ADC units.
+ * @return 0 on success, -1 if the input is not sampled, its window is not
+ * filled yet after a restart or the sampling is stopped for lack of DMA
+ * channels.
+ */
+int adc_sampler_read(uint input, float *raw);
+
+/**
+ * @brief Samples an input that cannot be sampled continuously, e.g. VSYS on
+ * Pico W where GPIO 29 is also the clock of the Wi-Fi chip. The free-running
+ * sampling pauses while DMA collects the burst at the full ADC rate (about
+ * 0.3 ms), the windows of the sampled inputs are kept.
+ *
+ * @param[in]  input ADC input 0-4, the GPIO of inputs 0-3 is set to analog.
+ * @param[out] raw   Mean of ADC_SAMPLER_SAMPLES_PER_INPUT samples in 12-bit
+ * ADC units, written on success only.
+ * @return 0 on success, -1 if the input is invalid, -2 if there was no free
+ * DMA channel for the burst or the sampled inputs could not be restarted
+ * after it. A sampling not restarted is retried by the next burst.
+ */
+int adc_sampler_burst(uint input, float *raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADC_SAMPLER_H_SENTRY
@@ -0,0 +1,47 @@
+#include "board_health.h"
+#include "adc_sampler.h"
+
+#include <pico/critical_section.h>
+#include <pico/cyw43_arch.h>
+
+/* VSYS is divided by 3 before the ADC, the reference is 3.3 V */
+#define VSYS_VOLTS_PER_RAW (3.0f * 3.3f / 4096)
+
+static board_health_t latest;
+static bool sampled = false;
+/* The net core writes, the sensor core reads */
+static critical_section_t latest_lock;
+
+void board_health_init() { critical_section_init(&latest_lock); }
+
+void board_health_sample() {
+  board_health_t health = {.time_us = time_us_32()};
+  float raw;
+  // The Wi-Fi chip must not use GPIO 29 during the burst
+  cyw43_thread_enter();
+#if CYW43_USES_VSYS_PIN
+  // Makes sure cyw43 is awake, as in the SDK power_status example
+  cyw43_arch_gpio_get(CYW43_WL_GPIO_VBUS_PIN);
+#endif
+  int res = adc_sampler_burst(PICO_VSYS_PIN - 26, &raw);
+  health.rssi_valid =
+      cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP &&
+      cyw43_wifi_get_rssi(&cyw43_state, &health.rssi_dbm) == 0;
+  cyw43_thread_exit();
+  // A failed burst is sent as a missing VSYS, the RSSI is still valid
+  health.vsys_valid = res == 0;
+  health.vsys_v = health.vsys_valid ? raw * VSYS_VOLTS_PER_RAW : 0.0f;
+
+  critical_section_enter_blocking(&latest_lock);
+  latest = health;
+  sampled = true;
+  critical_section_exit(&latest_lock);
+}
+
+int board_health_read(board_health_t *health) {
+  critical_section_enter_blocking(&latest_lock);
+  bool res = sampled;
+  *health = latest;
+  critical_section_exit(&latest_lock);
+  return res ? 0 : -1;
+}
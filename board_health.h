@@ -0,0 +1,51 @@
+/*
+ * Board health samples taken on the net core: VSYS and the RSSI of the STA.
+ * On Pico W the VSYS divider is read through GPIO 29, the clock of the Wi-Fi
+ * chip, so it is sampled by the core owning cyw43 with its lock held. The
+ * health sensor on the sensor core picks the latest samples up.
+ */
+#ifndef BOARD_HEALTH_H_SENTRY
+#define BOARD_HEALTH_H_SENTRY
+
+#include <pico/stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Latest net core samples.
+ */
+typedef struct {
+  float vsys_v;       ///< VSYS in volts, valid if vsys_valid
+  bool vsys_valid;    ///< The ADC burst of VSYS succeeded
+  int32_t rssi_dbm;   ///< RSSI of the STA, valid if rssi_valid
+  bool rssi_valid;    ///< The STA link was up at the sample
+  uint32_t time_us;   ///< Time since boot of the sample
+} board_health_t;
+
+/**
+ * @brief Initializes the sample storage. Must be called on core 0 before core
+ * 1 is launched.
+ */
+void board_health_init();
+/**
+ * @brief Samples VSYS and the RSSI. Must be called on the net core with cyw43
+ * initialized.
+ */
+void board_health_sample();
+/**
+ * @brief Copies the latest samples. Safe to call from both cores.
+ *
+ * @param[out] health Latest samples.
+ * @return 0 on success, -1 if nothing was sampled yet.
+ */
+int board_health_read(board_health_t *health);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOARD_HEALTH_H_SENTRY
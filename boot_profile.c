@@ -0,0 +1,92 @@
+#include "boot_profile.h"
+
+#include <hardware/timer.h>
+#include <pico/critical_section.h>
+#include <pico/platform.h>
+#include <stdio.h>
+#include <string.h>
+
+static boot_phase_t phases[BOOT_PROFILE_MAX_PHASES];
+static uint8_t number_of_phases = 0;
+static volatile bool sealed = false;
+/* Both cores record phases */
+static critical_section_t phases_lock;
+
+void boot_profile_init() { critical_section_init(&phases_lock); }
+
+void boot_profile_mark(const char *name) {
+  uint32_t now = time_us_32();
+  if (sealed) {
+    return;
+  }
+  critical_section_enter_blocking(&phases_lock);
+  if (number_of_phases < BOOT_PROFILE_MAX_PHASES) {
+    phases[number_of_phases].name = name;
+    phases[number_of_phases].time_us = now;
+    phases[number_of_phases].core = get_core_num();
+    number_of_phases++;
+  }
+  critical_section_exit(&phases_lock);
+}
+
+void boot_profile_seal() { sealed = true; }
+
+bool boot_profile_is_sealed() { return sealed; }
+
+/* Copies the phases, so they are formatted without holding the lock */
+static uint8_t copy_phases(boot_phase_t copy[BOOT_PROFILE_MAX_PHASES]) {
+  critical_section_enter_blocking(&phases_lock);
+  uint8_t count = number_of_phases;
+  memcpy(copy, phases, count * sizeof(boot_phase_t));
+  critical_section_exit(&phases_lock);
+  return count;
+}
+
+/* Previous phase finished on the same core, the phases of one core are
+ * sequential while the cores run in parallel */
+static uint32_t phase_start_us(const boot_phase_t *list, uint8_t index) {
+  for (int i = index - 1; i >= 0; i--) {
+    if (list[i].core == list[index].core) {
+      return list[i].time_us;
+    }
+  }
+  return 0;
+}
+
+#ifdef DEBUG
+void boot_profile_dump() {
+  boot_phase_t copy[BOOT_PROFILE_MAX_PHASES];
+  uint8_t count = copy_phases(copy);
+  printf("Boot phases (core, end ms, duration ms):\n");
+  for (uint8_t i = 0; i < count; i++) {
+    printf("  %-20s %d %8.1f %8.1f\n", copy[i].name, copy[i].core,
+           copy[i].time_us / 1000.0f,
+           (copy[i].time_us - phase_start_us(copy, i)) / 1000.0f);
+  }
+}
+#endif
+
+size_t boot_profile_to_json(char *str, size_t size) {
+  size_t used = 0;
+  int printed;
+  if (size < sizeof("{}")) {
+    return 0;
+  }
+  str[used++] = '{';
+  boot_phase_t copy[BOOT_PROFILE_MAX_PHASES];
+  uint8_t count = copy_phases(copy);
+  for (uint8_t i = 0; i < count; i++) {
+    // Leave room for the closing bracket
+    printed = snprintf(
+        &str[used], size - used - 1, "%s\"%s\":[%d,%lu,%lu]", i ? "," : "",
+        copy[i].name, copy[i].core, (unsigned long)(copy[i].time_us / 1000),
+        (unsigned long)((copy[i].time_us - phase_start_us(copy, i)) / 1000));
+    if (printed < 0 || (size_t)printed >= size - used - 1) {
+      break;
+    }
+    used += printed;
+  }
+  str[used++] = '}';
+  str[used] = 0;
+  return used;
+}
@@ -0,0 +1,66 @@
+/*
+ * Boot-phase recorder. Both cores mark the end of their boot phases with a
+ * timestamp, so the time from reset to the first publish can be broken down.
+ * The record is sealed once the first publish is done, later marks are
+ * ignored.
+ */
+#ifndef BOOT_PROFILE_H_SENTRY
+#define BOOT_PROFILE_H_SENTRY
+
+#include <pico/stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum number of phases recorded by both cores */
+#define BOOT_PROFILE_MAX_PHASES 24
+/* Buffer sufficient for the JSON formatted record */
+#define BOOT_PROFILE_JSON_SIZE 512
+/* Topic under the client ID the record is published to */
+#define BOOT_PROFILE_TOPIC "diag/boot"
+
+/**
+ * @brief Single boot phase, finished at `time_us` since boot.
+ */
+typedef struct {
+  const char *name; ///< Static string naming the finished phase
+  uint32_t time_us; ///< Time since boot the phase finished at
+  uint8_t core;     ///< Core that recorded the phase
+} boot_phase_t;
+
+/**
+ * @brief Initializes the recorder. Must be called on core 0 before core 1 is
+ * launched.
+ */
+void boot_profile_init();
+/**
+ * @brief Records the end of a boot phase. Safe to call from both cores.
+ *
+ * @param[in] name Static string naming the phase, the pointer is stored.
+ */
+void boot_profile_mark(const char *name);
+/**
+ * @brief Seals the record, the following marks are ignored.
+ */
+void boot_profile_seal();
+/**
+ * @brief Checks whether the record is sealed.
+ * @return true once boot_profile_seal was called.
+ */
+bool boot_profile_is_sealed();
+/**
+ * @brief Prints recorded phases with their durations to stdio (USB CDC).
+ *
+ * @note Debug builds only, release builds have no serial output.
+ */
+void boot_profile_dump();
+/**
+ * @brief Formats recorded phases as JSON: {"phase":[core,end_ms,delta_ms],...}
+ *
+ * @param[out] str  Buffer to store the JSON string.
+ * @param[in]  size Size of the buffer.
+ * @return Number of characters written (excluding the null terminator), the
+ * output is truncated to the last complete phase if the buffer is too small.
+ */
+size_t boot_profile_to_json(char *str, size_t size);
+
+#endif // BOOT_PROFILE_H_SENTRY
@@ -0,0 +1,52 @@
+#include "crc32.h"
+
+#include <hardware/dma.h>
+
+/* Data shorter than this is faster done by the CPU than by setting up DMA */
+#define CRC32_DMA_MIN_LEN 32
+
+static int crc_channel = -2; // -2 not claimed yet, -1 no free channel
+static dma_channel_config crc_config;
+static uint32_t crc_sink;
+
+static uint32_t crc32_software(uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static void claim_crc_channel() {
+  crc_channel = dma_claim_unused_channel(false);
+  if (crc_channel < 0) {
+    return;
+  }
+  crc_config = dma_channel_get_default_config(crc_channel);
+  channel_config_set_transfer_data_size(&crc_config, DMA_SIZE_8);
+  channel_config_set_read_increment(&crc_config, true);
+  channel_config_set_write_increment(&crc_config, false);
+  channel_config_set_sniff_enable(&crc_config, true);
+}
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+  if (crc_channel == -2) {
+    claim_crc_channel();
+  }
+  if (crc_channel < 0 || len < CRC32_DMA_MIN_LEN) {
+    return crc32_software(crc, data, len);
+  }
+  // Bit-reversed CRC32 matches the reflected zlib polynomial
+  dma_sniffer_enable(crc_channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+  dma_sniffer_set_output_invert_enabled(false);
+  dma_sniffer_set_output_reverse_enabled(false);
+  dma_sniffer_set_data_accumulator(~crc);
+  dma_channel_configure(crc_channel, &crc_config, &crc_sink, data, len, true);
+  dma_channel_wait_for_finish_blocking(crc_channel);
+  uint32_t result = ~dma_sniffer_get_data_accumulator();
+  dma_sniffer_disable();
+  return result;
+}
@@ -0,0 +1,29 @@
+/*
+ * CRC32 (IEEE 802.3, the zlib one) computed by the DMA sniffer. A DMA channel
+ * reads the data into a dummy word while the sniffer accumulates the CRC, so
+ * the XIP-mapped flash is checked without the CPU touching every byte.
+ */
+#ifndef CRC32_H_SENTRY
+#define CRC32_H_SENTRY
+
+#include <pico/stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Continues a CRC32 over the next chunk of data.
+ *
+ * @param[in] crc  CRC32 of the previous chunks, `0` for the first one.
+ * @param[in] data A pointer to the data, RAM or XIP-mapped flash.
+ * @param[in] len  Length of the data in bytes.
+ *
+ * @return CRC32 of the previous chunks followed by the data.
+ *
+ * @note
+ * - The DMA channel is claimed on the first call. The bitwise software CRC is
+ * used if no channel is free.
+ * - Not reentrant, must be called from a single core.
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len);
+
+#endif // CRC32_H_SENTRY
@@ -15,6 +15,17 @@
 static const uint PIO_SM_CLOCK_FREQUENCY = 1000000; // 1MHz
 static const uint DHT_LONG_PULSE_THRESHOLD_US = 50;
 static const uint DHT_MEASUREMENT_TIMEOUT_US = 6000;
+// DMA timer ticks pace the waits of the acquisition chain
+static const uint DHT_ACQUISITION_TICK_HZ = 10000;
+// read and written by the waits of the acquisition chain
+static uint32_t dht_acquisition_sink;
+
+// The program is loaded once per PIO and shared by the state machines of all
+// sensors on it
+static struct {
+    uint8_t users;
+    uint8_t offset;
+} dht_programs[NUM_PIOS];
 
 //
 // misc
@@ -33,7 +44,11 @@ static bool pio_sm_is_enabled(PIO pio, uint sm) {
     return (pio->ctrl & (1 << sm)) != 0;
 }
 
-static void dht_program_init(PIO pio, uint sm, uint offset, dht_model_t model, uint data_pin) {
+static uint get_long_pulse_threshold() {
+    return get_pio_sm_clocks(DHT_LONG_PULSE_THRESHOLD_US / dht_pulse_measurement_clocks_per_loop);
+}
+
+static void dht_sm_init(PIO pio, uint sm, uint offset, uint data_pin) {
     pio_sm_config c = dht_program_get_default_config(offset);
     uint32_t sys_clock_frequency = clock_get_hz(clk_sys);
     sm_config_set_clkdiv(&c, sys_clock_frequency / (float)PIO_SM_CLOCK_FREQUENCY);
@@ -43,10 +58,15 @@ static void dht_program_init(PIO pio, uint sm, uint offset, dht_model_t model, u
     // bits arrive in MSB order and are shifted to the left; autopush every 8 bits
     sm_config_set_in_shift(&c, false /* shift_right */, true /* autopush */, 8 /* push_threshold */);
     pio_sm_init(pio, sm, offset, &c);
+}
+
+// Prepares the state machine, the measurement starts once it is enabled
+static void dht_program_init(PIO pio, uint sm, uint offset, dht_model_t model, uint data_pin) {
+    dht_sm_init(pio, sm, offset, data_pin);
 
     // push timing values
     pio_sm_put_blocking(pio, sm, get_pio_sm_clocks(get_start_pulse_duration_us(model) / dht_start_signal_clocks_per_loop));
-    pio_sm_put_blocking(pio, sm, get_pio_sm_clocks(DHT_LONG_PULSE_THRESHOLD_US / dht_pulse_measurement_clocks_per_loop));
+    pio_sm_put_blocking(pio, sm, get_long_pulse_threshold());
     // drive the data pin low to wake sensor
     pio_sm_exec(pio, sm, pio_encode_set(pio_pindirs, 1));
     // pull the start-signal duration
@@ -55,18 +75,36 @@ static void dht_program_init(PIO pio, uint sm, uint offset, dht_model_t model, u
     pio_sm_exec(pio, sm, pio_encode_mov(pio_y, pio_osr));
     // pull the long pulse threshold
     pio_sm_exec(pio, sm, pio_encode_pull(/* if_empty */ false, /* block */ true));
-    // start executing the PIO program
-    pio_sm_set_enabled(pio, sm, true);
 }
 
-static void configure_dma_channel(uint chan, PIO pio, uint sm, uint8_t *write_addr) {
+static void configure_dma_channel(uint chan, PIO pio, uint sm, volatile uint8_t *write_addr, bool trigger) {
     dma_channel_config c = dma_channel_get_default_config(chan);
     channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false /* is_tx */));
     channel_config_set_irq_quiet(&c, true);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
     channel_config_set_read_increment(&c, false);
     channel_config_set_write_increment(&c, true);
-    dma_channel_configure(chan, &c, write_addr, &pio->rxf[sm], 5, true /* trigger */);
+    dma_channel_configure(chan, &c, write_addr, &pio->rxf[sm], 5, trigger);
+}
+
+static uint32_t get_block_ctrl(const dht_acquisition_t *acq, uint dreq, enum dma_channel_transfer_size size, bool increment) {
+    dma_channel_config c = dma_channel_get_default_config(acq->worker_chan);
+    channel_config_set_irq_quiet(&c, true);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, increment);
+    channel_config_set_write_increment(&c, increment);
+    channel_config_set_dreq(&c, dreq);
+    // the control channel loads the next block once this one is done
+    channel_config_set_chain_to(&c, acq->control_chan);
+    return channel_config_get_ctrl_value(&c);
+}
+
+static dht_dma_block_t *set_block(dht_dma_block_t *block, const volatile void *read_addr, volatile void *write_addr, uint32_t transfer_count, uint32_t ctrl) {
+    block->read_addr = read_addr;
+    block->write_addr = write_addr;
+    block->transfer_count = transfer_count;
+    block->ctrl = ctrl;
+    return block + 1;
 }
 
 static float decode_temperature(dht_model_t model, uint8_t b0, uint8_t b1) {
@@ -116,23 +154,55 @@ static float decode_humidity(dht_model_t model, uint8_t b0, uint8_t b1) {
     return humidity;
 }
 
+static dht_result_t decode_data(dht_model_t model, const volatile uint8_t *data, float *humidity, float *temperature_c) {
+    uint8_t checksum = data[0] + data[1] + data[2] + data[3];
+    if (data[4] != checksum) {
+        return DHT_RESULT_BAD_CHECKSUM;
+    }
+    if (humidity != NULL) {
+        *humidity = decode_humidity(model, data[0], data[1]);
+    }
+    if (temperature_c != NULL) {
+        *temperature_c = decode_temperature(model, data[2], data[3]);
+    }
+    return DHT_RESULT_OK;
+}
+
 //
 // public interface
 //
 
-void dht_init(dht_t *dht, dht_model_t model, PIO pio, uint8_t data_pin, bool pull_up) {
+bool dht_init(dht_t *dht, dht_model_t model, PIO pio, uint8_t data_pin, bool pull_up) {
     assert(pio == pio0 || pio == pio1);
 
     memset(dht, 0, sizeof(dht_t));
+    uint pio_index = pio_get_index(pio);
+    if (dht_programs[pio_index].users == 0 && !pio_can_add_program(pio, &dht_program)) {
+        return false;
+    }
+    int sm = pio_claim_unused_sm(pio, false /* required */);
+    if (sm < 0) {
+        return false;
+    }
+    int dma_chan = dma_claim_unused_channel(false /* required */);
+    if (dma_chan < 0) {
+        pio_sm_unclaim(pio, sm);
+        return false;
+    }
+    if (dht_programs[pio_index].users == 0) {
+        dht_programs[pio_index].offset = pio_add_program(pio, &dht_program);
+    }
+    dht_programs[pio_index].users++;
     dht->model = model;
     dht->pio = pio;
-    dht->pio_program_offset = pio_add_program(pio, &dht_program);
-    dht->sm = pio_claim_unused_sm(pio, true /* required */);
-    dht->dma_chan = dma_claim_unused_channel(true /* required */);
+    dht->pio_program_offset = dht_programs[pio_index].offset;
+    dht->sm = sm;
+    dht->dma_chan = dma_chan;
     dht->data_pin = data_pin;
 
     pio_gpio_init(pio, data_pin);
     gpio_set_pulls(data_pin, pull_up, false /* down */);
+    return true;
 }
 
 void dht_deinit(dht_t *dht) {
@@ -145,19 +215,40 @@ void dht_deinit(dht_t *dht) {
     // make sure pin is left in hi-z mode; original pin function & pulls are not restored
     pio_sm_set_consecutive_pindirs(dht->pio, dht->sm, dht->data_pin, 1, false /* is_out */);
     pio_sm_unclaim(dht->pio, dht->sm);
-    pio_remove_program(dht->pio, &dht_program, dht->pio_program_offset);
+    uint pio_index = pio_get_index(dht->pio);
+    if (--dht_programs[pio_index].users == 0) {
+        pio_remove_program(dht->pio, &dht_program, dht->pio_program_offset);
+    }
 
     dht->pio = NULL;
 }
 
 void dht_start_measurement(dht_t *dht) {
-    assert(dht->pio != NULL); // not initialized
-    assert(!pio_sm_is_enabled(dht->pio, dht->sm)); // another measurement in progress
+    dht_start_measurements(&dht, 1);
+}
+
+void dht_start_measurements(dht_t *const dhts[], uint count) {
+    uint32_t sm_masks[NUM_PIOS] = {0};
+    for (uint i = 0; i < count; i++) {
+        dht_t *dht = dhts[i];
+        assert(dht->pio != NULL); // not initialized
+        assert(!pio_sm_is_enabled(dht->pio, dht->sm)); // another measurement in progress
 
-    memset(dht->data, 0, sizeof(dht->data));
-    configure_dma_channel(dht->dma_chan, dht->pio, dht->sm, dht->data);
-    dht_program_init(dht->pio, dht->sm, dht->pio_program_offset, dht->model, dht->data_pin);
-    dht->start_time = time_us_32();
+        memset(dht->data, 0, sizeof(dht->data));
+        configure_dma_channel(dht->dma_chan, dht->pio, dht->sm, dht->data, true /* trigger */);
+        dht_program_init(dht->pio, dht->sm, dht->pio_program_offset, dht->model, dht->data_pin);
+        sm_masks[pio_get_index(dht->pio)] |= 1u << dht->sm;
+    }
+    // start executing the PIO program on all state machines of a PIO in the same cycle
+    uint32_t start_time = time_us_32();
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        if (sm_masks[i]) {
+            pio_enable_sm_mask_in_sync(pio_get_instance(i), sm_masks[i]);
+        }
+    }
+    for (uint i = 0; i < count; i++) {
+        dhts[i]->start_time = start_time;
+    }
 }
 
 dht_result_t dht_finish_measurement_blocking(dht_t *dht, float *humidity, float *temperature_c) {
@@ -176,15 +267,153 @@ dht_result_t dht_finish_measurement_blocking(dht_t *dht, float *humidity, float
         dma_channel_abort(dht->dma_chan);
         return DHT_RESULT_TIMEOUT;
     }
-    uint8_t checksum = dht->data[0] + dht->data[1] + dht->data[2] + dht->data[3];
-    if (dht->data[4] != checksum) {
-        return DHT_RESULT_BAD_CHECKSUM;
+    return decode_data(dht->model, dht->data, humidity, temperature_c);
+}
+
+bool dht_start_acquisition(dht_t *dht, dht_acquisition_t *acq, uint period_ms) {
+    assert(dht->pio != NULL); // not initialized
+    assert(!pio_sm_is_enabled(dht->pio, dht->sm)); // another measurement in progress
+    assert(period_ms >= 1000); // sensors need at least 1s between measurements
+
+    PIO pio = dht->pio;
+    uint sm = dht->sm;
+    memset(acq, 0, sizeof(dht_acquisition_t));
+    int control_chan = dma_claim_unused_channel(false /* required */);
+    int worker_chan = dma_claim_unused_channel(false /* required */);
+    int timer = dma_claim_unused_timer(false /* required */);
+    if (control_chan < 0 || worker_chan < 0 || timer < 0) {
+        if (control_chan >= 0) {
+            dma_channel_unclaim(control_chan);
+        }
+        if (worker_chan >= 0) {
+            dma_channel_unclaim(worker_chan);
+        }
+        if (timer >= 0) {
+            dma_timer_unclaim(timer);
+        }
+        return false;
     }
-    if (humidity != NULL) {
-        *humidity = decode_humidity(dht->model, dht->data[0], dht->data[1]);
+    acq->dht = dht;
+    acq->control_chan = control_chan;
+    acq->worker_chan = worker_chan;
+    acq->timer = timer;
+    dma_timer_set_fraction(acq->timer, 1, clock_get_hz(clk_sys) / DHT_ACQUISITION_TICK_HZ);
+    acq->start_instr = pio_encode_set(pio_pindirs, 1);
+    acq->release_instr = pio_encode_jmp(dht->pio_program_offset + dht_offset_release);
+    acq->abort_mask = 1u << dht->dma_chan;
+    acq->fifo_join_rx = PIO_SM0_SHIFTCTRL_FJOIN_RX_BITS;
+    // 0xff data fails the checksum until the sensor answers, followed by the fresh flag
+    memset(acq->fill, 0xff, sizeof(acq->fill) - 1);
+    acq->fill[sizeof(acq->fill) - 1] = 1;
+    acq->first_block = acq->blocks;
+
+    uint32_t start_ticks = (get_start_pulse_duration_us(dht->model) * DHT_ACQUISITION_TICK_HZ + 999999) / 1000000;
+    uint32_t period_ticks = period_ms * (DHT_ACQUISITION_TICK_HZ / 1000);
+    uint32_t wait_ctrl = get_block_ctrl(acq, dma_get_timer_dreq(acq->timer), DMA_SIZE_32, false);
+    uint32_t word_ctrl = get_block_ctrl(acq, DREQ_FORCE, DMA_SIZE_32, false);
+    uint32_t fill_ctrl = get_block_ctrl(acq, DREQ_FORCE, DMA_SIZE_8, true);
+
+    dht_dma_block_t *block = acq->blocks;
+    for (uint i = 0; i < DHT_ACQUISITION_SLOTS; i++) {
+        volatile dht_frame_t *frame = &acq->frames[i];
+        acq->data_addrs[i] = frame->data;
+        // idle until the start signal is due
+        block = set_block(block, &dht_acquisition_sink, &dht_acquisition_sink, period_ticks - start_ticks, wait_ctrl);
+        // drive the data pin low to wake sensor
+        block = set_block(block, &acq->start_instr, &pio->sm[sm].instr, 1, word_ctrl);
+        block = set_block(block, &timer_hw->timerawl, &frame->time_us, 1, word_ctrl);
+        block = set_block(block, &dht_acquisition_sink, &dht_acquisition_sink, start_ticks, wait_ctrl);
+        // restart the program where the sensor takes over the data pin
+        block = set_block(block, &acq->release_instr, &pio->sm[sm].instr, 1, word_ctrl);
+        // toggling the RX join twice clears the bytes of a frame cut short...
+        block = set_block(block, &acq->fifo_join_rx, hw_xor_alias(&pio->sm[sm].shiftctrl), 2, word_ctrl);
+        // ...for which the data channel may still wait
+        block = set_block(block, &acq->abort_mask, &dma_hw->abort, 1, word_ctrl);
+        block = set_block(block, acq->fill, frame->data, sizeof(acq->fill), fill_ctrl);
+        block = set_block(block, &acq->data_addrs[i], &dma_hw->ch[dht->dma_chan].al2_write_addr_trig, 1, word_ctrl);
     }
-    if (temperature_c != NULL) {
-        *temperature_c = decode_temperature(dht->model, dht->data[2], dht->data[3]);
+    // rewind the control channel to the first slot
+    set_block(block, &acq->first_block, &dma_hw->ch[acq->control_chan].read_addr, 1, word_ctrl);
+
+    configure_dma_channel(dht->dma_chan, pio, sm, acq->frames[0].data, false /* trigger */);
+
+    dht_sm_init(pio, sm, dht->pio_program_offset, dht->data_pin);
+    pio_sm_put_blocking(pio, sm, get_long_pulse_threshold());
+    // the long pulse threshold stays in OSR, the chain times the start signal
+    pio_sm_exec(pio, sm, pio_encode_pull(/* if_empty */ false, /* block */ true));
+    pio_sm_exec(pio, sm, pio_encode_jmp(dht->pio_program_offset + dht_offset_release));
+    pio_sm_set_enabled(pio, sm, true);
+
+    // the control channel copies every block into the registers of the worker
+    // channel, the last one (CTRL_TRIG) starts it
+    dma_channel_config c = dma_channel_get_default_config(acq->control_chan);
+    channel_config_set_irq_quiet(&c, true);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true /* write */, 4 /* 16 bytes */);
+    dma_channel_configure(acq->control_chan, &c, &dma_hw->ch[acq->worker_chan].read_addr, acq->blocks, 4, true /* trigger */);
+    return true;
+}
+
+void dht_stop_acquisition(dht_acquisition_t *acq) {
+    dht_t *dht = acq->dht;
+    assert(dht != NULL); // not acquiring
+
+    // a block finishing during the aborts would restart the chain
+    dma_channel_config c = dma_get_channel_config(acq->control_chan);
+    channel_config_set_enable(&c, false);
+    dma_channel_set_config(acq->control_chan, &c, false /* trigger */);
+    dma_channel_abort(acq->worker_chan);
+    dma_channel_abort(acq->control_chan);
+    dma_channel_abort(dht->dma_chan);
+    dma_channel_unclaim(acq->worker_chan);
+    dma_channel_unclaim(acq->control_chan);
+    dma_timer_unclaim(acq->timer);
+
+    pio_sm_set_enabled(dht->pio, dht->sm, false);
+    // make sure pin is left in hi-z mode
+    pio_sm_exec(dht->pio, dht->sm, pio_encode_set(pio_pindirs, 0));
+    acq->dht = NULL;
+}
+
+uint dht_collect_acquisition(dht_acquisition_t *acq, dht_reading_t *readings, uint max_readings) {
+    dht_t *dht = acq->dht;
+    assert(dht != NULL); // not acquiring
+
+    // the worker channel runs the block loaded last by the control channel
+    uint32_t loaded = dma_hw->ch[acq->control_chan].read_addr - (uintptr_t)acq->blocks;
+    uint block = loaded > 0 ? (loaded - 1) / sizeof(dht_dma_block_t) : 0;
+    uint slot = block / DHT_ACQUISITION_BLOCKS_PER_SLOT;
+    // while a slot waits for its start signal, the frame of the previous one may still arrive
+    bool waiting = block % DHT_ACQUISITION_BLOCKS_PER_SLOT == 0;
+    if (slot == DHT_ACQUISITION_SLOTS) {
+        // rewinding to the first slot
+        slot = 0;
+        waiting = true;
     }
-    return DHT_RESULT_OK;
+    uint previous = (slot + DHT_ACQUISITION_SLOTS - 1) % DHT_ACQUISITION_SLOTS;
+    uint32_t timeout = get_start_pulse_duration_us(dht->model) + DHT_MEASUREMENT_TIMEOUT_US;
+
+    uint count = 0;
+    // oldest frame first
+    for (uint i = 0; i < DHT_ACQUISITION_SLOTS && count < max_readings; i++) {
+        uint s = (slot + i) % DHT_ACQUISITION_SLOTS;
+        volatile dht_frame_t *frame = &acq->frames[s];
+        if (!frame->fresh || (s == slot && !waiting)) {
+            continue;
+        }
+        if (s == previous && waiting && dma_channel_is_busy(dht->dma_chan) && time_us_32() - frame->time_us < timeout) {
+            continue;
+        }
+        dht_reading_t *reading = &readings[count++];
+        reading->time_us = frame->time_us;
+        if ((frame->data[0] & frame->data[1] & frame->data[2] & frame->data[3] & frame->data[4]) == 0xff) {
+            reading->result = DHT_RESULT_TIMEOUT;
+        } else {
+            reading->result = decode_data(dht->model, frame->data, &reading->humidity, &reading->temperature_c);
+        }
+        frame->fresh = 0;
+    }
+    return count;
 }
@@ -52,19 +52,84 @@ typedef enum dht_result_t {
     DHT_RESULT_BAD_CHECKSUM, /**< Sensor data doesn't match checksum. */
 } dht_result_t;
 
+/**
+ * \brief Number of frames kept by an autonomous acquisition.
+ */
+#define DHT_ACQUISITION_SLOTS 8
+
+/**
+ * \brief DMA control blocks run for every frame of an autonomous acquisition.
+ */
+#define DHT_ACQUISITION_BLOCKS_PER_SLOT 9
+
+/**
+ * \brief Frame slot written by DMA during an autonomous acquisition.
+ */
+typedef struct dht_frame_t {
+    uint32_t time_us; /**< Timer value at the start signal. */
+    uint8_t data[5]; /**< Sensor data, 0xff until the sensor answers. */
+    uint8_t fresh; /**< Set by DMA, cleared once the frame is collected. */
+} dht_frame_t;
+
+/**
+ * \brief DMA control block, copied into the registers of the worker channel.
+ */
+typedef struct dht_dma_block_t {
+    const volatile void *read_addr;
+    volatile void *write_addr;
+    uint32_t transfer_count;
+    uint32_t ctrl;
+} dht_dma_block_t;
+
+/**
+ * \brief Autonomous acquisition of a DHT sensor.
+ *
+ * Holds the ring of frame slots and the DMA control blocks which measure into
+ * them. Must stay in place while the acquisition runs.
+ */
+typedef struct dht_acquisition_t {
+    dht_t *dht;
+    volatile dht_frame_t frames[DHT_ACQUISITION_SLOTS];
+    dht_dma_block_t blocks[DHT_ACQUISITION_SLOTS * DHT_ACQUISITION_BLOCKS_PER_SLOT + 1];
+    // read by the control blocks, in RAM as flash operations stop XIP while the chain runs
+    uint32_t start_instr;
+    uint32_t release_instr;
+    uint32_t abort_mask;
+    uint32_t fifo_join_rx;
+    uint8_t fill[sizeof(((dht_frame_t *)0)->data) + 1]; // data and the fresh flag of a frame
+    dht_dma_block_t *first_block;
+    volatile uint8_t *data_addrs[DHT_ACQUISITION_SLOTS];
+    uint8_t control_chan;
+    uint8_t worker_chan;
+    uint8_t timer;
+} dht_acquisition_t;
+
+/**
+ * \brief Reading of a frame collected from an autonomous acquisition.
+ */
+typedef struct dht_reading_t {
+    uint32_t time_us; /**< Timer value at the start signal. */
+    dht_result_t result; /**< Result status. */
+    float humidity; /**< Relative humidity, if result is DHT_RESULT_OK. */
+    float temperature_c; /**< Degrees Celsius, if result is DHT_RESULT_OK. */
+} dht_reading_t;
+
 /**
  * \brief Initialize DHT sensor.
  * 
  * The library claims one state machine from the given PIO instance, and one DMA
- * channel to communicate with the sensor.
+ * channel to communicate with the sensor. The PIO program is loaded once per
+ * PIO instance and shared by all sensors on it, up to 4 sensors fit a PIO.
  * 
  * \param dht DHT sensor.
  * \param model DHT sensor model.
  * \param pio PIO block to use (pio0 or pio1).
  * \param data_pin Sensor data pin.
  * \param pull_up Whether to enable the internal pull-up.
+ * \return false if the program does not fit the PIO or no state machine or
+ * DMA channel is free, nothing is claimed then.
  */
-void dht_init(dht_t *dht, dht_model_t model, PIO pio, uint8_t data_pin, bool pull_up);
+bool dht_init(dht_t *dht, dht_model_t model, PIO pio, uint8_t data_pin, bool pull_up);
 
 /**
  * \brief Deinitialize DHT sensor.
@@ -86,6 +151,18 @@ void dht_deinit(dht_t *dht);
  */
 void dht_start_measurement(dht_t *dht);
 
+/**
+ * \brief Start asynchronous measurement of several sensors at once.
+ *
+ * The state machines of the sensors on a PIO instance are enabled in the same
+ * clock cycle, so all sensors are measured in one measurement window. Finish
+ * each of them with dht_finish_measurement_blocking(), the waits overlap.
+ *
+ * \param dhts DHT sensors, none of them measuring.
+ * \param count Number of sensors.
+ */
+void dht_start_measurements(dht_t *const dhts[], uint count);
+
 /**
  * \brief Wait for measurement to complete and get the result.
  *
@@ -96,6 +173,41 @@ void dht_start_measurement(dht_t *dht);
  */
 dht_result_t dht_finish_measurement_blocking(dht_t *dht, float *humidity, float *temperature_c);
 
+/**
+ * \brief Start measuring periodically without the CPU.
+ *
+ * A chain of DMA control blocks, paced by a DMA timer, drives the start
+ * signal, restarts the PIO program and points the DMA channel of the sensor
+ * at the next slot of the frame ring, stamped with the timer. The CPU only
+ * collects the frames. Claims two more DMA channels and a DMA timer.
+ *
+ * \param dht DHT sensor, not measuring.
+ * \param acq Acquisition state, must stay in place until stopped.
+ * \param period_ms Time between measurements, at least 1000 ms.
+ * \return false if no DMA channels or timer are free, nothing is claimed then.
+ */
+bool dht_start_acquisition(dht_t *dht, dht_acquisition_t *acq, uint period_ms);
+
+/**
+ * \brief Stop an autonomous acquisition and release its DMA resources.
+ *
+ * \param acq Acquisition state.
+ */
+void dht_stop_acquisition(dht_acquisition_t *acq);
+
+/**
+ * \brief Validate the frames measured since the last call.
+ *
+ * Frames of a ring that was not collected for DHT_ACQUISITION_SLOTS periods
+ * are overwritten.
+ *
+ * \param acq Acquisition state.
+ * \param[out] readings Readings, oldest first.
+ * \param max_readings Size of readings.
+ * \return Number of readings.
+ */
+uint dht_collect_acquisition(dht_acquisition_t *acq, dht_reading_t *readings, uint max_readings);
+
 #ifdef __cplusplus
 }
 #endif
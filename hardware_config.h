@@ -6,10 +6,36 @@
 /* Water-proof DS18B20 temp sensor */
 #define DS18B20_PIN 2
 #define DS18B20_PIO pio1
-/* DHT 11 with PIO-based library */
+/* DHT 11 with PIO-based library. Up to 4 DHTs share the program on DHT_PIO,
+ * one state machine each, and are measured together */
 #define DHT_MODEL DHT11
 #define DHT_DATA_PIN 0
+/* Second room sensor, enable the room2 entry of sensors_registry.h */
+#define DHT2_DATA_PIN 1
 #define DHT_PIO pio0
+/* DHTs measure on their own this often, paced by DMA without the CPU; 0 starts
+ * them from the sensor loop instead. Needs 2 DMA channels and a DMA timer per
+ * DHT */
+#define DHT_ACQUISITION_PERIOD_MS 5000
+/* Capacitive soil moisture probe, analog output on an ADC pin (26-28) */
+#define MOISTURE_PIN 26
+/* Raw 12-bit readings of the probe in dry air and in water, the moisture is
+ * interpolated between them. Calibrate them for the probe in use */
+#define MOISTURE_DRY_RAW 3500
+#define MOISTURE_WET_RAW 1500
+/* Sensors should not be queried earlier than this after power-up */
+#define SENSORS_POWER_UP_MS 1500
+
+/*---BOARD HEALTH---*/
+/* The net core samples VSYS and the RSSI this often */
+#define BOARD_HEALTH_SAMPLE_MS 10000
+/* Health is sent when a value moved by more than its deadband, not more often
+ * than the min period and at least every max period */
+#define BOARD_HEALTH_VSYS_DEADBAND_V 0.1f
+#define BOARD_HEALTH_TEMP_DEADBAND_C 2.0f
+#define BOARD_HEALTH_RSSI_DEADBAND_DBM 6
+#define BOARD_HEALTH_MIN_PERIOD_MS 30000
+#define BOARD_HEALTH_MAX_PERIOD_MS 600000
 
 /*---CONTROL DEVICES---*/
 #define CONTROL_BUFFER_SIZE 256
@@ -22,5 +48,14 @@
 /* Relay driven light */
 #define LIGHT_PIN 7
 #define DEFAULT_SETTINGS_BUTTON 10
+/* Button is considered settled after a number of equal reads in a row */
+#define BUTTON_STABLE_READS 5
+#define BUTTON_SETTLE_TIMEOUT_MS 50
+/* Presses closer than this are contact bounce of the same press */
+#define BUTTON_DEBOUNCE_MS 250
+
+/*---DEBUG---*/
+/* Debug builds wait for a USB CDC terminal no longer than this */
+#define USB_CONNECT_TIMEOUT_MS 4000
 
 #endif // !HARDWARE_CONFIG_H_SENTRY
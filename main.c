@@ -1,9 +1,13 @@
+#include "board_health.h"
+#include "boot_profile.h"
 #include "dhcpserver.h"
 #include "dnsserver.h"
 #include "hardware_config.h"
 #include "http_control.h"
+#include "non_volatile.h"
 #include "runtime_settings.h"
 #include "sensors.h"
+#include "sse_server.h"
 #include "tls_mqtt_client.h"
 #include "utility.h"
 #include "wifi_arch.h"
@@ -12,6 +16,7 @@
 
 #include <cyw43.h>
 #include <cyw43_configport.h>
+#include <assert.h>
 #include <hardware/gpio.h>
 #include <lwip/apps/httpd.h>
 #include <lwip/arch.h>
@@ -21,11 +26,13 @@
 #include <mbedtls/ssl.h>
 #include <pico.h>
 #include <pico/cyw43_arch.h>
+#include <pico/stdio_usb.h>
 #include <pico/stdlib.h>
 
 #include <lwip/dns.h>
 #include <lwip/pbuf.h>
 #include <lwip/tcp.h>
+#include <lwip/udp.h>
 
 #include <lwip/altcp_tcp.h>
 #include <lwip/altcp_tls.h>
@@ -40,43 +47,74 @@
 #include <string.h>
 #include <time.h>
 // Multicore capabilities
+#include <pico/async_context.h>
+#include <pico/critical_section.h>
 #include <pico/multicore.h>
 #include <pico/mutex.h>
+#include <pico/sem.h>
 #include <pico/util/queue.h>
-// Restart feature
-#include <hardware/watchdog.h>
 // Water portion to turn off water once user forgot to do it
 #include <hardware/timer.h>
+#ifdef DEBUG
+#include <hardware/structs/systick.h>
+#endif
 
-/* Restart the net core once settings are changed */
-/* Rewritten in the HTTPD server callback */
+/* Settings in use by the net core */
 static tls_mqtt_settings mqtt_settings;
+/* Rewritten in the HTTPD server callback, applied once stored */
+static tls_mqtt_settings edited_settings;
 volatile bool store_settings_flag = false;
 volatile bool restore_settings_flag = false;
 volatile bool settings_changed = false;
 
-volatile bool reset_core = false;
-mutex_t reset_core_mutex;
-
 typedef struct {
   uint8_t topic_index;
-  uint8_t data[128];
+  uint32_t queued_us; // Time the sample was queued, used to measure latency
+  uint8_t data[SENSOR_DATA_SIZE];
 } queue_entry_t;
 
+/* Upper bound for the net core sleep, network work and the sensor doorbell
+ * wake the loop earlier */
+#define NET_LOOP_MAX_SLEEP_MS 1000
+
 /* Queue used by sensor core to pass data to net core */
 queue_t sensor_data_queue;
 
+/* Doorbell rung by the sensor core once a sample is queued. It marks a worker
+ * of the cyw43 async context as pending, so the net core loop wakes up on
+ * either network work or new data */
+static void sensor_doorbell_work(async_context_t *context,
+                                 async_when_pending_worker_t *worker);
+static async_when_pending_worker_t sensor_doorbell = {
+    .do_work = sensor_doorbell_work};
+/* The async context exists only while cyw43 is initialized */
+static bool doorbell_armed = false;
+static critical_section_t doorbell_lock;
+#if !PICO_CYW43_ARCH_POLL
+/* lwIP is serviced from IRQ, the loop sleeps on this semaphore until the
+ * doorbell worker moved new data */
+static semaphore_t net_loop_sem;
+#endif
+/* Set once new sensor data was moved from the queue */
+static volatile bool new_sensor_data = false;
+/* Time the oldest not yet published sample was queued */
+static uint32_t unpublished_since_us;
+
+/* Sample-to-publish latency statistics */
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+} latency_stats_t;
+static latency_stats_t publish_latency = {.min_us = UINT32_MAX};
+
 /* Sensor section initialization
- * Sensor topics are used to store data from the queue so HTTPD and MQTT client
- * can fetch the topics for SSI and Publish */
-const char *sensor_topics[] = {
-    "r_hum",
-    "r_temp",
-    "w_temp",
-    "moist",
-};
-#define NUMBER_OF_SENSOR_TOPICS sizeof(sensor_topics) / sizeof(sensor_topics[0])
+ * Data of the sensor topics (sensors_registry.h) are stored from the queue so
+ * HTTPD and MQTT client can fetch the topics for SSI and Publish */
 queue_entry_t current_sensor_data[NUMBER_OF_SENSOR_TOPICS];
+/* Incremented on every update of a topic, SSE streams send changed topics */
+static uint32_t current_sensor_version[NUMBER_OF_SENSOR_TOPICS];
 
 /* Control section initialization
  * Control topics are topics that perform actions required by client */
@@ -192,19 +230,43 @@ uint16_t sensor_ssi_handler(int i_index, char *pc_insert, int insert_len) {
   }
   return (uint16_t)printed;
 }
+/* JSON snapshot of the latest sensor values for /api/sensors, the topic data
+ * are JSON objects already. Called from the lwIP context, the same as the SSI
+ * handler. A truncated snapshot is not valid JSON, 0 is returned instead */
+uint16_t sensors_json(char *buffer, uint16_t size) {
+  size_t printed = snprintf(buffer, size, "{");
+  for (uint8_t i = 0; i < NUMBER_OF_SENSOR_TOPICS && printed < size; i++) {
+    const char *data = (const char *)current_sensor_data[i].data;
+    printed += snprintf(buffer + printed, size - printed, "%s\"%s\":%s",
+                        i ? "," : "", sensor_topics[i],
+                        data[0] ? data : "null");
+  }
+  if (printed < size) {
+    printed += snprintf(buffer + printed, size - printed, "}");
+  }
+  if (printed >= size) {
+    DEBUG_PRINT("Sensors JSON truncated at %u bytes\n", size);
+    return 0;
+  }
+  return (uint16_t)printed;
+}
+/* Data of a topic for the SSE streams, called from the lwIP context */
+const char *sensor_topic_data(uint8_t index, uint32_t *version) {
+  *version = current_sensor_version[index];
+  return (const char *)current_sensor_data[index].data;
+}
 /* This function is passed to httpd to parse incoming POST requests */
 void process_post_field(const char *key, const char *value) {
-  const field_info_t *fields = get_settings_fields();
-  uint8_t num_fields = get_settings_fields_count();
-  for (uint8_t i = 0; i < num_fields; i++) {
-    if (strcmp(fields[i].field_name, key) == 0) {
-      unsigned long value_size = strlen(value);
-      if (value_size < fields[i].size && value_size > 0) {
-        memcpy((uint8_t *)&mqtt_settings + fields[i].offset, value,
-               value_size + 1);
-        settings_changed = true;
-      }
-    }
+  int index = find_settings_field(key);
+  if (index < 0) {
+    DEBUG_PRINT("Unknown settings field %s\n", key);
+    return;
+  }
+  const field_info_t *field = &get_settings_fields()[index];
+  unsigned long value_size = strlen(value);
+  if (value_size < field->size && value_size > 0) {
+    memcpy((uint8_t *)&edited_settings + field->offset, value, value_size + 1);
+    settings_changed = true;
   }
 }
 /* Preforms reading from the queue, copies acquired data to the
@@ -215,11 +277,108 @@ bool try_read_data_from_queue() {
   queue_entry_t temp;
   bool ret = queue_try_remove(&sensor_data_queue, &temp);
   if (ret) {
+    if (!new_sensor_data) {
+      unpublished_since_us = temp.queued_us;
+      new_sensor_data = true;
+    }
+    // SSI handler reads the data from the lwIP context
+    cyw43_arch_lwip_begin();
     memcpy(&current_sensor_data[temp.topic_index], &temp, sizeof(temp));
+    current_sensor_version[temp.topic_index]++;
+    cyw43_arch_lwip_end();
     DEBUG_PRINT("ID: %d, DATA: %s\n", temp.topic_index, temp.data);
   }
   return ret;
 }
+/* Runs on the net core from the cyw43 async context once the doorbell rang */
+static void sensor_doorbell_work(async_context_t *context,
+                                 async_when_pending_worker_t *worker) {
+  while (try_read_data_from_queue()) {
+  }
+#if !PICO_CYW43_ARCH_POLL
+  sem_release(&net_loop_sem);
+#endif
+}
+
+/* Services the network in the poll variant, in threadsafe_background cyw43
+ * and lwIP are serviced from IRQ */
+#if PICO_CYW43_ARCH_POLL
+/* Longest time pending network work could wait for the loop. Waiting for work
+ * is not counted as pending work ends the wait. The threadsafe_background
+ * variant services the network from IRQ, so there is no such gap */
+static uint32_t last_service_us = 0;
+static uint32_t max_gap_us = 0;
+#endif
+static void net_loop_service() {
+#if PICO_CYW43_ARCH_POLL
+  uint32_t now = time_us_32();
+  uint32_t gap = now - last_service_us;
+  if (last_service_us != 0 && gap > max_gap_us) {
+    max_gap_us = gap;
+    DEBUG_PRINT("Longest lwIP service gap: %lu us\n", (unsigned long)gap);
+  }
+  cyw43_arch_poll();
+  last_service_us = time_us_32();
+#endif
+}
+
+/* Sleeps until network work (poll variant only), the sensor doorbell or
+ * until */
+static void net_loop_wait_until(absolute_time_t until) {
+#if PICO_CYW43_ARCH_POLL
+  cyw43_arch_wait_for_work_until(until);
+  last_service_us = time_us_32();
+#else
+  sem_acquire_block_until(&net_loop_sem, until);
+#endif
+}
+
+static void arm_doorbell() {
+  async_context_add_when_pending_worker(cyw43_arch_async_context(),
+                                        &sensor_doorbell);
+  critical_section_enter_blocking(&doorbell_lock);
+  doorbell_armed = true;
+  critical_section_exit(&doorbell_lock);
+}
+
+/* Should be called before cyw43_arch_deinit */
+static void disarm_doorbell() {
+  critical_section_enter_blocking(&doorbell_lock);
+  doorbell_armed = false;
+  critical_section_exit(&doorbell_lock);
+  async_context_remove_when_pending_worker(cyw43_arch_async_context(),
+                                           &sensor_doorbell);
+}
+
+/* Called on the sensor core after a sample is queued */
+static void ring_doorbell() {
+  critical_section_enter_blocking(&doorbell_lock);
+  if (doorbell_armed) {
+    async_context_set_work_pending(cyw43_arch_async_context(),
+                                   &sensor_doorbell);
+  }
+  critical_section_exit(&doorbell_lock);
+}
+
+static void record_publish_latency() {
+  uint32_t latency = time_us_32() - unpublished_since_us;
+  new_sensor_data = false;
+  publish_latency.count++;
+  publish_latency.total_us += latency;
+  if (latency < publish_latency.min_us) {
+    publish_latency.min_us = latency;
+  }
+  if (latency > publish_latency.max_us) {
+    publish_latency.max_us = latency;
+  }
+  DEBUG_PRINT("Sample-to-publish latency: %lu us (min %lu, avg %lu, max %lu, "
+              "n %lu)\n",
+              (unsigned long)latency, (unsigned long)publish_latency.min_us,
+              (unsigned long)(publish_latency.total_us / publish_latency.count),
+              (unsigned long)publish_latency.max_us,
+              (unsigned long)publish_latency.count);
+}
+
 /* Custom function passed to the MQTT client to perform server command */
 void server_command_handler(uint8_t topic_number, const uint8_t *data,
                             size_t len) {
@@ -228,16 +387,25 @@ void server_command_handler(uint8_t topic_number, const uint8_t *data,
 
 err_t publish_topic_data(MQTT_CLIENT_T *state) {
   char full_topic[108];
-  err_t err;
+  err_t err = ERR_OK;
+  /* Sensor and control data is also accessed from the lwIP context. The lock
+   * is recursive, tls_mqtt_publish takes it again */
+  cyw43_arch_lwip_begin();
   /* Publish all sensor data */
   for (int i = 0; i < NUMBER_OF_SENSOR_TOPICS; i++) {
     queue_entry_t *current_sensor_record = &current_sensor_data[i];
+    // Not fitted or not sampled yet
+    if (current_sensor_record->data[0] == 0) {
+      continue;
+    }
     sprintf(full_topic, "%s/%s", state->settings->tls_mqtt_client_id,
             sensor_topics[i]);
     err = tls_mqtt_publish(state, full_topic, current_sensor_record->data,
-                           strlen((char *)current_sensor_record->data), QOS);
+                           strlen((char *)current_sensor_record->data), QOS,
+                           0);
     if (err != ERR_OK) {
       DEBUG_PRINT("publish topic data error: %d\n", err);
+      cyw43_arch_lwip_end();
       return err;
     }
   }
@@ -247,13 +415,49 @@ err_t publish_topic_data(MQTT_CLIENT_T *state) {
 
     err = tls_mqtt_publish(
         state, full_topic, (uint8_t *)current_control_state[i].topic_data,
-        strlen((char *)current_control_state[i].topic_data), QOS);
+        strlen((char *)current_control_state[i].topic_data), QOS, 0);
     if (err != ERR_OK) {
       DEBUG_PRINT("publish topic data error: %d\n", err);
-      return err;
+      break;
     }
   }
-  return ERR_OK;
+  cyw43_arch_lwip_end();
+  return err;
+}
+
+/* Dumps the boot phases over USB CDC (Debug builds) and publishes them once as
+ * a retained diagnostics message */
+static void report_boot_profile(MQTT_CLIENT_T *state) {
+  char full_topic[108];
+  char payload[BOOT_PROFILE_JSON_SIZE];
+  boot_profile_seal();
+#ifdef DEBUG
+  boot_profile_dump();
+#endif
+  size_t len = boot_profile_to_json(payload, sizeof(payload));
+  snprintf(full_topic, sizeof(full_topic), "%s/%s",
+           state->settings->tls_mqtt_client_id, BOOT_PROFILE_TOPIC);
+  err_t err =
+      tls_mqtt_publish(state, full_topic, (uint8_t *)payload, len, QOS, 1);
+  if (err != ERR_OK) {
+    DEBUG_PRINT("publish boot profile error: %d\n", err);
+  }
+}
+
+/* The pull-up needs a moment to charge the line. Instead of a fixed delay the
+ * button is sampled until it reads the same value several times in a row */
+static bool read_settled_button() {
+  bool level = gpio_get(DEFAULT_SETTINGS_BUTTON);
+  uint8_t stable = 0;
+  absolute_time_t until = make_timeout_time_ms(BUTTON_SETTLE_TIMEOUT_MS);
+  while (stable < BUTTON_STABLE_READS &&
+         absolute_time_diff_us(get_absolute_time(), until) > 0) {
+    sleep_us(200);
+    bool new_level = gpio_get(DEFAULT_SETTINGS_BUTTON);
+    stable = new_level == level ? stable + 1 : 0;
+    level = new_level;
+  }
+  return level;
 }
 
 // Initialization from net core to serve incoming commands
@@ -276,95 +480,311 @@ void init_net_hardware() {
   gpio_put(LIGHT_PIN, 0);
 }
 
-static void httpd_ap_mode() {
-  ip_addr_t gw;
-  ip4_addr_t mask;
+/* Stores the settings edited via the form. Returns true if they changed and
+ * were saved; otherwise the edits are dropped and the previous settings stay
+ * active, so the form can be submitted again */
+static bool store_edited_settings() {
+  store_settings_flag = false;
+  bool saved =
+      settings_changed && write_settings_in_flash(&edited_settings) == 0;
+  settings_changed = false;
+  if (!saved) {
+    memcpy(&edited_settings, &mqtt_settings, sizeof(tls_mqtt_settings));
+  }
+  return saved;
+}
+
+/* VSYS and the RSSI for the health sensor, sampled from the net loops */
+static void sample_board_health() {
+  static absolute_time_t next_sample;
+  if (absolute_time_diff_us(get_absolute_time(), next_sample) > 0) {
+    return;
+  }
+  next_sample = make_timeout_time_ms(BOARD_HEALTH_SAMPLE_MS);
+  board_health_sample();
+}
+
+/* Config portal served on the AP interface: DHCP, DNS, httpd and the SSE
+ * stream. The servers are bound to the AP netif, so they do not answer on
+ * the STA network when both interfaces run */
+static struct {
+  bool running;
   dhcp_server_t dhcp_server;
   dns_server_t dns_server;
-  /* Copy settings are used to store settings entered with POST request */
-  tls_mqtt_settings *copy_settings =
-      (tls_mqtt_settings *)malloc(sizeof(tls_mqtt_settings));
-  if (copy_settings == NULL) {
-    DEBUG_PRINT("Error allocating memory for settings\n");
+} portal;
+
+/* MACs of the DHCP leases, kept across AP sessions and reboots so a phone
+ * gets its previous address back */
+typedef uint8_t dhcp_lease_macs_t[DHCPS_MAX_IP][DHCPS_MAC_LEN];
+static_assert(sizeof(dhcp_lease_macs_t) <= NON_VOL_SMALL_RECORD_MAX,
+              "The journal blocks are sized for fewer DHCP leases");
+
+/* Starts the portal servers, the AP interface should be up */
+static void portal_start() {
+  ip_addr_t gw;
+  ip4_addr_t mask;
+  struct netif *ap_netif = &cyw43_state.netif[CYW43_ITF_AP];
+  static bool leases_loaded = false;
+  IP4_ADDR(ip_2_ip4(&gw), 192, 168, 4, 1);
+  IP4_ADDR(ip_2_ip4(&mask), 255, 255, 255, 0);
+
+  if (!leases_loaded) {
+    dhcp_lease_macs_t macs;
+    if (read_from_non_volatile(NON_VOL_KEY_DHCP_LEASES, (uint8_t *)macs,
+                               sizeof(macs)) == sizeof(macs)) {
+      dhcp_server_import_leases(&portal.dhcp_server, macs);
+    }
+    leases_loaded = true;
+  }
+  cyw43_arch_lwip_begin();
+  // Start the dhcp server
+  dhcp_server_init(&portal.dhcp_server, &gw, &mask);
+  if (portal.dhcp_server.udp != NULL) {
+    udp_bind_netif(portal.dhcp_server.udp, ap_netif);
+  }
+  // Start the dns server
+  dns_server_init(&portal.dns_server, &gw);
+  if (portal.dns_server.udp != NULL) {
+    udp_bind_netif(portal.dns_server.udp, ap_netif);
+  }
+  cyw43_arch_lwip_end();
+  my_httpd_run(sensor_ssi_handler, sensor_topics, NUMBER_OF_SENSOR_TOPICS,
+               process_post_field, sensors_json, &store_settings_flag);
+  my_httpd_set_portal_netif(ap_netif);
+  cyw43_arch_lwip_begin();
+  if (sse_server_init(sensor_topics, NUMBER_OF_SENSOR_TOPICS,
+                      sensor_topic_data, ap_netif) != ERR_OK) {
+    DEBUG_PRINT("Error starting SSE server\n");
+  }
+  cyw43_arch_lwip_end();
+  portal.running = true;
+}
+
+/* Stops the portal servers, should be called before the AP goes down */
+static void portal_stop() {
+  if (!portal.running) {
+    return;
+  }
+  // httpd cannot be stopped, its listener stays but refuses every request
+  my_httpd_set_portal_netif(NULL);
+  dhcp_lease_macs_t macs;
+  cyw43_arch_lwip_begin();
+  sse_server_deinit();
+  dns_server_deinit(&portal.dns_server);
+  bool leases_changed = dhcp_server_export_leases(&portal.dhcp_server, macs);
+  dhcp_server_deinit(&portal.dhcp_server);
+  cyw43_arch_lwip_end();
+  // Stored once per portal session, only if a new client got an address
+  if (leases_changed) {
+    write_in_non_volatile(NON_VOL_KEY_DHCP_LEASES, (const uint8_t *)macs,
+                          sizeof(macs));
+  }
+  portal.running = false;
+}
+
+static void portal_service() {
+  if (!portal.running) {
     return;
   }
-  // Deep copy is performed as settings are arrays of chars
-  memcpy(copy_settings, &mqtt_settings, sizeof(tls_mqtt_settings));
+  cyw43_arch_lwip_begin();
+  sse_server_service();
+  cyw43_arch_lwip_end();
+}
 
+/* Set from the button IRQ, the STA loop toggles the portal */
+static volatile bool portal_toggle_requested = false;
+
+static void button_irq_callback(uint gpio, uint32_t events) {
+  static uint32_t last_press_us = 0;
+  uint32_t now = time_us_32();
+  // Contact bounce produces a burst of edges per press
+  if (gpio != DEFAULT_SETTINGS_BUTTON ||
+      now - last_press_us < BUTTON_DEBOUNCE_MS * 1000) {
+    return;
+  }
+  last_press_us = now;
+  portal_toggle_requested = true;
+  // Wakes the net core loop
+  ring_doorbell();
+}
+
+/* Runs the AP mode until new settings are saved. The AP is torn down and the
+ * saved settings become active */
+static void httpd_ap_mode() {
   int res = setup_ap(COUNTRY, AP_MODE_SSID, AP_MODE_PASS, AUTH);
   if (res) {
     DEBUG_PRINT("Error setting up AP mode\n");
   } else {
-    IP4_ADDR(ip_2_ip4(&gw), 192, 168, 4, 1);
-    IP4_ADDR(ip_2_ip4(&mask), 255, 255, 255, 0);
-
-    // Start the dhcp server
-    dhcp_server_init(&dhcp_server, &gw, &mask);
-    // Start the dns server
-    dns_server_init(&dns_server, &gw);
-    my_httpd_run(sensor_ssi_handler, sensor_topics, NUMBER_OF_SENSOR_TOPICS,
-                 process_post_field, &store_settings_flag);
+    portal_start();
+    arm_doorbell();
   }
   while (true) {
+    // Serves the network and the sensor doorbell
+    net_loop_service();
     while (try_read_data_from_queue()) {
     }
-    if (store_settings_flag) {
-      if (settings_changed) {
-        break;
-      } else {
-        store_settings_flag = false;
-      }
+    portal_service();
+    sample_board_health();
+    // POST is processed by httpd during the poll above
+    if (store_settings_flag && store_edited_settings()) {
+      break;
     }
-#if PICO_CYW43_ARCH_POLL
-    cyw43_arch_poll();
-    cyw43_arch_wait_for_work_until(make_timeout_time_ms(200));
-#else
-    sleep_ms(200);
-#endif
+    net_loop_wait_until(make_timeout_time_ms(NET_LOOP_MAX_SLEEP_MS));
+  }
+  if (!res) {
+    disarm_doorbell();
   }
-  free(copy_settings);
-  dns_server_deinit(&dns_server);
-  dhcp_server_deinit(&dhcp_server);
+  portal_stop();
   cyw43_arch_deinit();
-  if (store_settings_flag) {
-    store_settings_flag = false;
-    write_settings_in_flash(&mqtt_settings);
-    // Blocking entrance to ensure other core will not skip check
-    mutex_enter_blocking(&reset_core_mutex);
-    reset_core = true;
-    mutex_exit(&reset_core_mutex);
+  memcpy(&mqtt_settings, &edited_settings, sizeof(tls_mqtt_settings));
+}
+
+/* Creates the MQTT client and starts connecting to the broker */
+static void start_mqtt(MQTT_CLIENT_T **state) {
+  TLS_MQTT_RET ret =
+      tls_mqtt_init(state, &mqtt_settings, server_command_handler);
+  if (ret != TLS_MQTT_OK) {
+    DEBUG_PRINT("MQTT client error: %s\n", tls_mqtt_strerr(ret));
+    return;
+  }
+  // After connection mqtt client will perform other actions via callbacks
+  if (tls_mqtt_connect(*state) != ERR_OK) {
+    DEBUG_PRINT("MQTT client error: %s\n",
+                tls_mqtt_strerr(TLS_MQTT_ERR_CONNECT));
+  }
+}
+
+/* Applies the stored settings without a reboot. Only the layers with a
+ * changed field are restarted: Wi-Fi rejoins the network, a broker change
+ * creates a new client (DNS lookup, TLS config, connection), a credentials
+ * change starts a new MQTT session on the existing client. The sensor core
+ * keeps sampling, its data is queued meanwhile */
+static void apply_edited_settings(MQTT_CLIENT_T **state,
+                                  wifi_join_cache_t *join_cache) {
+  uint8_t layers = settings_diff_layers(&mqtt_settings, &edited_settings);
+  DEBUG_PRINT("Applying settings, changed layers: 0x%x\n", layers);
+  if (layers & (SETTINGS_LAYER_WIFI | SETTINGS_LAYER_BROKER)) {
+    tls_mqtt_deinit(state);
+  }
+  // The client refers to mqtt_settings, it is disconnected or rebuilt below
+  memcpy(&mqtt_settings, &edited_settings, sizeof(tls_mqtt_settings));
+  if (layers & SETTINGS_LAYER_WIFI) {
+    // The cache belongs to the previous network, a full join refreshes it
+    memset(join_cache, 0, sizeof(wifi_join_cache_t));
+    if (reconnect_sta(mqtt_settings.wifi_ssid, mqtt_settings.wifi_pass, AUTH,
+                      join_cache) != CYW43_LINK_UP) {
+      DEBUG_PRINT("Error joining %s\n", mqtt_settings.wifi_ssid);
+    }
+  }
+  if (*state == NULL) {
+    // Also retries a client that failed to start with the previous settings
+    start_mqtt(state);
+  } else if (layers & SETTINGS_LAYER_CLIENT) {
+    TLS_MQTT_RET ret = tls_mqtt_reconnect(*state);
+    if (ret != TLS_MQTT_OK) {
+      DEBUG_PRINT("MQTT client error: %s\n", tls_mqtt_strerr(ret));
+    }
   }
 }
 
 void mqtt_sta_mode() {
   absolute_time_t timeout = nil_time;
   int res;
-  TLS_MQTT_RET ret;
   MQTT_CLIENT_T *state;
+  /* Last successful association is used to skip the scan and DHCP */
+  static wifi_join_cache_t join_cache;
+  bool fast_rejoin = false;
+  bool first_publish = true;
+  // Until the join from the cache is shown to reach the broker or gateway
+  absolute_time_t cache_deadline = nil_time;
+  if (read_wifi_join_cache(&join_cache)) {
+    // Empty cache forces the full scan, association and DHCP exchange
+    memset(&join_cache, 0, sizeof(join_cache));
+  }
   res = setup_sta(COUNTRY, mqtt_settings.wifi_ssid, mqtt_settings.wifi_pass,
-                  AUTH, mqtt_settings.tls_mqtt_client_id, NULL, NULL, NULL);
-  state = NULL;
-  ret = tls_mqtt_init(&state, &mqtt_settings, server_command_handler);
-  if (ret == TLS_MQTT_OK) {
-    // After connection mqtt client will perform other actions via callbacks
-    ret = tls_mqtt_connect(state);
+                  AUTH, mqtt_settings.tls_mqtt_client_id, NULL, NULL, NULL,
+                  &join_cache, &fast_rejoin);
+  boot_profile_mark(fast_rejoin ? "wifi_fast_rejoin" : "wifi_full_join");
+  if (fast_rejoin) {
+    cache_deadline = make_timeout_time_ms(WIFI_CACHE_VERIFY_TIMEOUT_MS);
+  }
+  // 1 is returned only if cyw43 (and its async context) failed to initialize
+  if (res != 1) {
+    arm_doorbell();
+    // The button toggles the config portal next to the STA from now on
+    portal_toggle_requested = false;
+    gpio_set_irq_enabled_with_callback(DEFAULT_SETTINGS_BUTTON,
+                                       GPIO_IRQ_EDGE_FALL, true,
+                                       button_irq_callback);
   }
+  state = NULL;
+  // Includes DNS lookup and TLS config parsing
+  start_mqtt(&state);
+  boot_profile_mark("mqtt_init_dns");
   while (true) {
+    // Serves the network and the sensor doorbell
+    net_loop_service();
     absolute_time_t now = get_absolute_time();
     while (try_read_data_from_queue()) {
     }
-    if (is_nil_time(timeout) || absolute_time_diff_us(now, timeout) <= 0) {
-      if (state->is_connected) {
+    if (portal_toggle_requested) {
+      portal_toggle_requested = false;
+      if (portal.running) {
+        portal_stop();
+        disable_ap();
+      } else {
+        enable_ap_with_sta(AP_MODE_SSID, AP_MODE_PASS, AUTH);
+        portal_start();
+      }
+    }
+    portal_service();
+    sample_board_health();
+    // Settings stored via the portal while the STA runs
+    if (store_settings_flag && store_edited_settings()) {
+      apply_edited_settings(&state, &join_cache);
+      // Publish as soon as the new connection is up
+      timeout = nil_time;
+    }
+    bool connected = state != NULL && state->is_connected;
+    // DHCP binds after a join from the cache, or renews with another lease
+    refresh_wifi_join_cache(&join_cache);
+    if (!is_nil_time(cache_deadline)) {
+      if (connected || wifi_gateway_resolved()) {
+        cache_deadline = nil_time;
+      } else if (absolute_time_diff_us(now, cache_deadline) <= 0) {
+        // The next boot joins with a scan and a DHCP exchange
+        drop_wifi_join_cache(&join_cache);
+        cache_deadline = nil_time;
+      }
+    }
+    if (first_publish && connected) {
+      // TLS handshake and MQTT CONNECT/CONNACK
+      boot_profile_mark("mqtt_connected");
+    }
+    /* Fresh samples are published right away, otherwise the last known
+     * state is republished periodically */
+    if (new_sensor_data || is_nil_time(timeout) ||
+        absolute_time_diff_us(now, timeout) <= 0) {
+      if (connected) {
+        bool fresh = new_sensor_data;
         publish_topic_data(state);
+        if (fresh) {
+          record_publish_latency();
+        }
         timeout = make_timeout_time_ms(3000);
+        if (first_publish) {
+          first_publish = false;
+          boot_profile_mark("first_publish");
+          report_boot_profile(state);
+        }
       }
     }
-#if PICO_CYW43_ARCH_POLL
-    cyw43_arch_poll();
-    cyw43_arch_wait_for_work_until(make_timeout_time_ms(200));
-#else
-    sleep_ms(200);
-#endif
+    // Sleep until network work, the doorbell or the next periodic publish
+    absolute_time_t wake = make_timeout_time_ms(NET_LOOP_MAX_SLEEP_MS);
+    if (!is_nil_time(timeout) && absolute_time_diff_us(timeout, wake) > 0) {
+      wake = timeout;
+    }
+    net_loop_wait_until(wake);
   }
 }
 /* Entry into the net responsible core
@@ -376,9 +796,9 @@ void core1_entry() {
   MQTT_CLIENT_T *state;
   // Initialize hardware running on net core
   init_net_hardware();
-  sleep_ms(50);
   // Button is low when it is pressed
-  bool button_pressed = gpio_get(DEFAULT_SETTINGS_BUTTON) == 0;
+  bool button_pressed = read_settled_button() == 0;
+  boot_profile_mark("net_hw_init");
   /* Perform reading settings from the flash or initialize default */
   res = read_settings_from_flash(&mqtt_settings);
   if (res) {
@@ -387,65 +807,117 @@ void core1_entry() {
     initialize_default_settings(&mqtt_settings);
     write_settings_in_flash(&mqtt_settings);
   }
-  /* Turn into httpd in AP mode */
+  memcpy(&edited_settings, &mqtt_settings, sizeof(tls_mqtt_settings));
+  boot_profile_mark("settings_read");
+  /* Turn into httpd in AP mode, the STA starts once settings are saved */
   if (button_pressed) {
     httpd_ap_mode();
-  } else {
-    mqtt_sta_mode();
   }
+  mqtt_sta_mode();
 }
 
 static void pass_sensor_data_to_queue(const char *str, uint size,
-                                      uint8_t topic_number) {
+                                      sensor_topic_t topic_number) {
   queue_entry_t q_entry = {.topic_index = topic_number};
   assert(sizeof(q_entry.data) >= size);
   strncpy((char *)q_entry.data, str, sizeof(q_entry.data));
   DEBUG_PRINT("\n%s\n", q_entry.data);
+  q_entry.queued_us = time_us_32();
   queue_add_blocking(&sensor_data_queue, &q_entry);
+  ring_doorbell();
+}
+
+/* Sensor transactions are not interrupted by flash writes of the net core,
+ * a write in progress delays the transaction instead */
+static void begin_sensor_transaction() {
+  uint32_t start = time_us_32();
+  non_volatile_hold_writes();
+  uint32_t waited = time_us_32() - start;
+  if (waited > 1000) {
+    DEBUG_PRINT("Sensor transaction delayed by flash write: %lu us\n",
+                waited);
+  }
+}
+
+#ifdef DEBUG
+/* Core 0 cycle counter for the cost of the sensor layer. prepare_sensors()
+ * does not block, collect and transfer are dominated by the sensor waits and
+ * the queue. SysTick counts the CPU clock down and wraps after 2^24 cycles
+ * (134 ms at 125 MHz) */
+static void start_cycle_counter() {
+  systick_hw->rvr = 0xffffff;
+  systick_hw->cvr = 0;
+  systick_hw->csr = 0x5; // Enabled, processor clock, no interrupt
+}
+
+static uint32_t cycles_since(uint32_t start) {
+  return (start - systick_hw->cvr) & 0xffffff;
+}
+#endif
+
+/* Waits for a terminal to open USB CDC so the boot output is not lost. Only
+ * Debug builds wait, and no longer than USB_CONNECT_TIMEOUT_MS */
+static void wait_for_usb_terminal() {
+#ifdef DEBUG
+  absolute_time_t until = make_timeout_time_ms(USB_CONNECT_TIMEOUT_MS);
+  while (!stdio_usb_connected() &&
+         absolute_time_diff_us(get_absolute_time(), until) > 0) {
+    sleep_ms(10);
+  }
+#endif
 }
 
 int main() {
+  boot_profile_init();
+  board_health_init();
   stdio_init_all();
-  sleep_ms(4000);
+  wait_for_usb_terminal();
+  boot_profile_mark("usb_stdio");
   // Init queue to send data from sensors collected on the 0 core to the 1
   // core
   queue_init(&sensor_data_queue, sizeof(queue_entry_t), 10);
-  // Initialize mutex responsible for restarting net core
-  mutex_init(&reset_core_mutex);
+  critical_section_init(&doorbell_lock);
+#if !PICO_CYW43_ARCH_POLL
+  sem_init(&net_loop_sem, 0, 1);
+#endif
   // Lock 0 core if the 1 core is going to write into the flash
   multicore_lockout_victim_init();
   multicore_launch_core1(core1_entry);
-  bool restart = false;
+  bool first_sample = true;
+  begin_sensor_transaction();
   init_sensors();
-  sleep_ms(2000);
+  non_volatile_release_writes();
+  boot_profile_mark("sensors_init");
+  /* Sensors need some time after power-up before the first measurement is
+   * reliable, the time already spent on booting is counted */
+  sleep_until(from_us_since_boot(SENSORS_POWER_UP_MS * 1000ull));
+  boot_profile_mark("sensors_power_up");
+#ifdef DEBUG
+  start_cycle_counter();
+  uint32_t cycles_start = 0;
+#endif
   while (true) {
     DEBUG_PRINT("New main iteration\n");
+    begin_sensor_transaction();
+#ifdef DEBUG
+    cycles_start = systick_hw->cvr;
+#endif
     prepare_sensors();
-    DEBUG_PRINT("prepare_sensors()\n");
+    DEBUG_PRINT("prepare_sensors(): %lu cycles\n",
+                (unsigned long)cycles_since(cycles_start));
+    non_volatile_release_writes();
 
     sleep_ms(2000);
+    begin_sensor_transaction();
     collect_data_sensors();
+    non_volatile_release_writes();
     DEBUG_PRINT("collect_data_sensors\n");
 
     transfer_data_sensors(pass_sensor_data_to_queue);
     DEBUG_PRINT("transfer_data_sensors()\n");
-
-    /* Check whether the Pico core needs to be restarted
-     * restart is needed when settings are stored and Pico needs to reconnect
-     */
-    mutex_enter_blocking(&reset_core_mutex);
-    restart = reset_core;
-    if (reset_core) {
-      reset_core = false;
-      deinit_clean_sensors();
-    }
-    mutex_exit(&reset_core_mutex);
-    if (restart) {
-      DEBUG_PRINT("Waiting to be rebooted by the watchdog\n");
-      watchdog_enable(100, 0);
-      // Just wait the restart
-      while (1) {
-      }
+    if (first_sample) {
+      first_sample = false;
+      boot_profile_mark("first_sample");
     }
     sleep_ms(3000);
   }
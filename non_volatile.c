@@ -1,7 +1,9 @@
 #include "non_volatile.h"
+#include "crc32.h"
 #include "utility.h"
 
 #include <boards/pico_w.h>
+#include <assert.h>
 #include <hardware/flash.h>
 #include <hardware/regs/addressmap.h>
 #include <hardware/regs/intctrl.h>
@@ -9,45 +11,382 @@
 #include <lwip/arch.h>
 #include <pico.h>
 #include <pico/multicore.h>
+#include <pico/mutex.h>
 #include <pico/stdlib.h>
 #include <string.h>
 
+#define PAGES_PER_BLOCK (NON_VOL_BLOCK_SIZE / NON_VOL_PAGE_SIZE)
+static_assert(NON_VOL_RECORD_PAGES(0) == 1 &&
+                  NON_VOL_RECORD_PAGES(NON_VOL_PAGE_SIZE -
+                                       sizeof(non_vol_record_t)) == 1,
+              "NON_VOL_RECORD_PAGES does not match the record header");
+/* Flash offset of the journal, XIP_BASE is added for reading */
+#define REGION_START (PICO_FLASH_SIZE_BYTES - NON_VOL_REGION_SIZE)
+
+/* Position of a valid record found during the scan */
+typedef struct {
+  uint8_t block;
+  uint16_t page;
+  const non_vol_record_t *header; // Points into XIP
+} record_pos_t;
+
+/* Write position in the journal, restored by scanning on the first access */
+static struct {
+  bool scanned;
+  uint8_t block;
+  uint16_t page;
+  uint32_t next_seq;
+} journal;
+
+/* Page is assembled in RAM as flash_range_program cannot program from XIP */
+static uint8_t page_buffer[NON_VOL_PAGE_SIZE];
+
 static uint8_t number_of_segments(uint16_t length, int segment) {
   return (length + segment - 1) / segment;
 }
-void read_from_non_volatile(uint8_t *buffer, uint16_t length) {
-  // points to the place on the flash with a data to be read. erasing flash
-  // is performed in the flash memory space, but reading is possible
-  // not only for the flash memory, that is why XIP_BASE offset is used to
-  // reach the start of the flash + write_start
-  uint8_t num_segments = number_of_segments(length, NON_VOL_SEGMENT_SIZE);
-  int read_start =
-      PICO_FLASH_SIZE_BYTES - (NON_VOL_SEGMENT_SIZE * num_segments) + XIP_BASE;
-  char *flash_mem = (char *)read_start;
-  memcpy(buffer, flash_mem, length);
-  DEBUG_PRINT("\nread_from_non_volatile num_segments: %d, read_start: %d\n",
-              num_segments, read_start);
+
+static uint32_t record_crc(const non_vol_record_t *header,
+                           const uint8_t *data) {
+  non_vol_record_t temp = *header;
+  temp.crc = 0;
+  uint32_t crc = crc32_update(0, (const uint8_t *)&temp, sizeof(temp));
+  return crc32_update(crc, data, header->length);
 }
 
-int write_in_non_volatile(const uint8_t *data, uint16_t length) {
-  uint8_t num_segments = number_of_segments(length, NON_VOL_SEGMENT_SIZE);
-  // Seek the end, step offset
-  int write_start =
-      PICO_FLASH_SIZE_BYTES - (NON_VOL_SEGMENT_SIZE * num_segments);
-  uint8_t number_of_pages = number_of_segments(length, NON_VOL_PAGE_SIZE);
-  // START critical section, interrupts may interfere flash during writing (for
-  // some reasion clangd writes that save_and_disable_interrupts is not defined
-  // but it is not true)
+static uint32_t page_offset(uint8_t block, uint16_t page) {
+  return REGION_START + block * NON_VOL_BLOCK_SIZE + page * NON_VOL_PAGE_SIZE;
+}
+
+static const uint8_t *page_xip(uint8_t block, uint16_t page) {
+  return (const uint8_t *)(XIP_BASE + page_offset(block, page));
+}
+
+static uint16_t record_pages(uint16_t length) {
+  return number_of_segments(sizeof(non_vol_record_t) + length,
+                            NON_VOL_PAGE_SIZE);
+}
+
+/* Returns the header if a valid record starts at the page */
+static const non_vol_record_t *valid_record_at(uint8_t block, uint16_t page) {
+  const non_vol_record_t *header =
+      (const non_vol_record_t *)page_xip(block, page);
+  if (header->magic != NON_VOL_RECORD_MAGIC) {
+    return NULL;
+  }
+  // Length may be garbage if the header was torn
+  if (page + record_pages(header->length) > PAGES_PER_BLOCK) {
+    return NULL;
+  }
+  if (record_crc(header, (const uint8_t *)(header + 1)) != header->crc) {
+    return NULL;
+  }
+  return header;
+}
+
+/* Calls fn for every valid record, stops once fn returns true */
+static bool for_each_record(bool (*fn)(const record_pos_t *pos, void *arg),
+                            void *arg) {
+  for (uint8_t block = 0; block < NON_VOL_BLOCKS; block++) {
+    uint16_t page = 0;
+    while (page < PAGES_PER_BLOCK) {
+      record_pos_t pos = {.block = block,
+                          .page = page,
+                          .header = valid_record_at(block, page)};
+      if (pos.header == NULL) {
+        page++;
+        continue;
+      }
+      if (fn(&pos, arg)) {
+        return true;
+      }
+      page += record_pages(pos.header->length);
+    }
+  }
+  return false;
+}
+
+/* Newest record of every key, built by the scan and kept up to date by the
+ * writes, so reads do not scan the flash */
+typedef struct {
+  uint16_t key;
+  uint8_t block;
+  uint16_t page;
+} index_entry_t;
+static index_entry_t key_index[NON_VOL_MAX_KEYS];
+static uint16_t key_index_length = 0;
+
+static const non_vol_record_t *index_header(const index_entry_t *entry) {
+  return (const non_vol_record_t *)page_xip(entry->block, entry->page);
+}
+
+static index_entry_t *index_find(uint16_t key) {
+  for (uint16_t i = 0; i < key_index_length; i++) {
+    if (key_index[i].key == key) {
+      return &key_index[i];
+    }
+  }
+  return NULL;
+}
+
+static bool index_update(uint16_t key, uint8_t block, uint16_t page) {
+  index_entry_t *entry = index_find(key);
+  if (entry == NULL) {
+    if (key_index_length == NON_VOL_MAX_KEYS) {
+      DEBUG_PRINT("Journal index is full, key %d is dropped\n", key);
+      return false;
+    }
+    entry = &key_index[key_index_length++];
+    entry->key = key;
+  }
+  entry->block = block;
+  entry->page = page;
+  return true;
+}
+
+static bool scan_fn(const record_pos_t *pos, void *arg) {
+  record_pos_t *newest = (record_pos_t *)arg;
+  index_entry_t *entry = index_find(pos->header->key);
+  if (entry == NULL || index_header(entry)->seq < pos->header->seq) {
+    index_update(pos->header->key, pos->block, pos->page);
+  }
+  if (newest->header == NULL || newest->header->seq < pos->header->seq) {
+    *newest = *pos;
+  }
+  return false;
+}
+
+static void scan_journal() {
+  record_pos_t newest = {.header = NULL};
+  key_index_length = 0;
+  for_each_record(scan_fn, &newest);
+  if (newest.header != NULL) {
+    journal.block = newest.block;
+    journal.page = newest.page + record_pages(newest.header->length);
+    journal.next_seq = newest.header->seq + 1;
+  } else {
+    journal.block = 0;
+    journal.page = 0;
+    journal.next_seq = 1;
+  }
+  journal.scanned = true;
+  DEBUG_PRINT("Journal write position: block %d, page %d, seq %lu, keys %d\n",
+              journal.block, journal.page, (unsigned long)journal.next_seq,
+              key_index_length);
+}
+
+/* True if the newest record of a key is in the block */
+static bool holds_live_records(uint8_t block) {
+  for (uint16_t i = 0; i < key_index_length; i++) {
+    if (key_index[i].block == block) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool is_blank(const uint8_t *mem, uint32_t length) {
+  const uint32_t *word = (const uint32_t *)mem;
+  for (uint32_t i = 0; i < length / sizeof(uint32_t); i++) {
+    if (word[i] != 0xFFFFFFFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Held by the sensor core during timing-critical transactions, flash
+ * operations wait for it before locking the sensor core out */
+auto_init_mutex(sensor_window_mutex);
+
+void non_volatile_hold_writes() { mutex_enter_blocking(&sensor_window_mutex); }
+
+void non_volatile_release_writes() { mutex_exit(&sensor_window_mutex); }
+
+/* START critical section, interrupts may interfere flash during writing (for
+ * some reasion clangd writes that save_and_disable_interrupts is not defined
+ * but it is not true). Every flash operation is a separate critical section, so
+ * the other core is not locked out for the whole write. The lockout lands only
+ * between sensor transactions */
+static uint32_t flash_op_begin() {
+  mutex_enter_blocking(&sensor_window_mutex);
   uint32_t status = save_and_disable_interrupts();
   multicore_lockout_start_blocking();
-  // Erase memory on the end of the flash
-  flash_range_erase(write_start, NON_VOL_SEGMENT_SIZE * num_segments);
-  // Copy data
-  flash_range_program(write_start, data, number_of_pages * NON_VOL_PAGE_SIZE);
-  // Now leave the critical area
+  return status;
+}
+
+static void flash_op_end(uint32_t status) {
   multicore_lockout_end_blocking();
   restore_interrupts(status);
-  DEBUG_PRINT(
-      "num_segments: %d, write_start: %d, number_of_pages %d, read_start: %d\n",
-      num_segments, write_start, number_of_pages, write_start + XIP_BASE);
+  mutex_exit(&sensor_window_mutex);
+}
+
+static void erase_block(uint8_t block) {
+  for (uint8_t i = 0; i < NON_VOL_BLOCK_SEGMENTS; i++) {
+    uint32_t offset = page_offset(block, 0) + i * NON_VOL_SEGMENT_SIZE;
+    uint32_t status = flash_op_begin();
+    flash_range_erase(offset, NON_VOL_SEGMENT_SIZE);
+    flash_op_end(status);
+  }
+  DEBUG_PRINT("Journal block %d erased\n", block);
+}
+
+static void program_page(uint8_t block, uint16_t page) {
+  uint32_t status = flash_op_begin();
+  flash_range_program(page_offset(block, page), page_buffer,
+                      NON_VOL_PAGE_SIZE);
+  flash_op_end(status);
+}
+
+/* Programs a record at the write position, the caller checked the space */
+static bool program_record(uint16_t key, const uint8_t *data,
+                           uint16_t length) {
+  non_vol_record_t header = {.magic = NON_VOL_RECORD_MAGIC,
+                             .seq = journal.next_seq++,
+                             .key = key,
+                             .length = length,
+                             .crc = 0};
+  header.crc = record_crc(&header, data);
+  uint16_t pages = record_pages(length);
+  uint32_t copied = 0;
+  for (uint16_t i = 0; i < pages; i++) {
+    uint32_t used = 0;
+    memset(page_buffer, 0xFF, sizeof(page_buffer));
+    if (i == 0) {
+      memcpy(page_buffer, &header, sizeof(header));
+      used = sizeof(header);
+    }
+    uint32_t chunk = MIN(NON_VOL_PAGE_SIZE - used, length - copied);
+    memcpy(&page_buffer[used], &data[copied], chunk);
+    copied += chunk;
+    program_page(journal.block, journal.page + i);
+  }
+  bool indexed = index_update(key, journal.block, journal.page);
+  journal.page += pages;
+  return indexed;
+}
+
+static bool fits_write_block(uint16_t length) {
+  uint16_t pages = record_pages(length);
+  if (journal.page + pages > PAGES_PER_BLOCK) {
+    return false;
+  }
+  // Pages after a torn write are not blank, they cannot be programmed
+  return is_blank(page_xip(journal.block, journal.page),
+                  pages * NON_VOL_PAGE_SIZE);
+}
+
+/* Live records of the victim block: newest records of their keys */
+typedef struct {
+  uint8_t victim;
+  bool no_space;
+} relocate_t;
+
+static bool relocate_fn(const record_pos_t *pos, void *arg) {
+  relocate_t *relocate = (relocate_t *)arg;
+  if (pos->block != relocate->victim) {
+    return false;
+  }
+  index_entry_t *entry = index_find(pos->header->key);
+  if (entry == NULL || entry->block != pos->block ||
+      entry->page != pos->page) {
+    return false;
+  }
+  if (!fits_write_block(pos->header->length)) {
+    relocate->no_space = true;
+    return true;
+  }
+  DEBUG_PRINT("Journal relocates key %d\n", pos->header->key);
+  // Data is copied from XIP into the page buffer before every page program
+  program_record(pos->header->key, (const uint8_t *)(pos->header + 1),
+                 pos->header->length);
+  return false;
+}
+
+/* Moves the write position into the spare block. The oldest block is garbage
+ * collected and erased to become the new spare */
+static bool advance_block() {
+  uint8_t next = (journal.block + 1) % NON_VOL_BLOCKS;
+  uint8_t victim = (next + 1) % NON_VOL_BLOCKS;
+  /* The spare is not blank on the first use or after a torn erase. A victim
+   * left by a failed garbage collection still holds live records, it is never
+   * erased */
+  if (holds_live_records(next)) {
+    DEBUG_PRINT("Journal spare block %d holds live records\n", next);
+    return false;
+  }
+  if (!is_blank(page_xip(next, 0), NON_VOL_BLOCK_SIZE)) {
+    erase_block(next);
+  }
+  journal.block = next;
+  journal.page = 0;
+  relocate_t relocate = {.victim = victim, .no_space = false};
+  for_each_record(relocate_fn, &relocate);
+  // The victim is erased only once all of its live records are copied
+  if (relocate.no_space || holds_live_records(victim)) {
+    DEBUG_PRINT("Journal live records do not fit into a block\n");
+    return false;
+  }
+  if (!is_blank(page_xip(victim, 0), NON_VOL_BLOCK_SIZE)) {
+    erase_block(victim);
+  }
+  return true;
+}
+
+const uint8_t *map_non_volatile(uint16_t key, uint16_t *length) {
+  if (!journal.scanned) {
+    scan_journal();
+  }
+  index_entry_t *entry = index_find(key);
+  if (entry == NULL) {
+    return NULL;
+  }
+  const non_vol_record_t *header = index_header(entry);
+  if (length != NULL) {
+    *length = header->length;
+  }
+  return (const uint8_t *)(header + 1);
+}
+
+int read_from_non_volatile(uint16_t key, uint8_t *buffer, uint16_t length) {
+  uint16_t record_length;
+  const uint8_t *data = map_non_volatile(key, &record_length);
+  if (data == NULL) {
+    DEBUG_PRINT("read_from_non_volatile no record for key %d\n", key);
+    return -1;
+  }
+  memcpy(buffer, data, MIN(length, record_length));
+  return record_length;
+}
+
+int write_in_non_volatile(uint16_t key, const uint8_t *data, uint16_t length) {
+  if (length > NON_VOL_RECORD_MAX) {
+    DEBUG_PRINT("write_in_non_volatile record is too large: %d\n", length);
+    return -1;
+  }
+  if (!journal.scanned) {
+    scan_journal();
+  }
+  /* The first block has to be prepared on an empty journal */
+  if (journal.next_seq == 1 && journal.page == 0 &&
+      !is_blank(page_xip(journal.block, 0), NON_VOL_BLOCK_SIZE)) {
+    erase_block(journal.block);
+  }
+  if (!fits_write_block(length)) {
+    if (!advance_block() || !fits_write_block(length)) {
+      return -2;
+    }
+  }
+  if (!program_record(key, data, length)) {
+    return -3;
+  }
+  DEBUG_PRINT("write_in_non_volatile key: %d, block: %d, page: %d\n", key,
+              journal.block, journal.page);
+  return 0;
+}
+
+void read_legacy_from_non_volatile(uint8_t *buffer, uint16_t length) {
+  uint8_t num_segments = number_of_segments(length, NON_VOL_SEGMENT_SIZE);
+  uintptr_t read_start =
+      PICO_FLASH_SIZE_BYTES - (NON_VOL_SEGMENT_SIZE * num_segments) + XIP_BASE;
+  memcpy(buffer, (const uint8_t *)read_start, length);
 }
@@ -2,65 +2,195 @@
  * Header file enables operation on non-volatile memory to store mqtt and wifi
  * settings after restarts.
  * Pico W has 2 MB flash
- * The process of overwriting memory:
- *  1. Get the end of the flash memory (flash simple starts from 0x1000, but
- *  writing to the beginning will overwrite the program code, so first seek for
- *  the flash end). PICO_FLASH_SIZE_BYTES defines the size of the flash,
- * XIP_BASE defines the beginning of the Flash memory, so
- * XIP_BASE+PICO_FLASH_SIZE_BYTES will point to the end of Flash memory.
+ * Flash basics:
+ *  1. The end of the flash memory is used (flash simple starts from 0x1000,
+ *  but writing to the beginning will overwrite the program code).
+ *  PICO_FLASH_SIZE_BYTES defines the size of the flash, XIP_BASE defines the
+ *  beginning of the Flash memory, so XIP_BASE+PICO_FLASH_SIZE_BYTES will point
+ *  to the end of Flash memory.
  *  2. Erase a memory segment (multiples 4096 bytes)
  *  3. Write page (multiples 256 bytes)
+ *
+ * Journal:
+ * The region at the end of the flash is split into NON_VOL_BLOCKS blocks used
+ * as a ring. Records are appended page aligned, every record holds a key, a
+ * sequence number and a CRC32. The newest valid record of a key is its current
+ * value, so a torn write leaves the previous record in place. A block is
+ * erased only when the write position leaves the previous one: the block after
+ * the write block is always kept erased, the oldest block is garbage collected
+ * (live records are moved into the new write block) and becomes the new spare.
+ * A block is sized to hold the worst-case live set of the keys below next to a
+ * new record of the largest size, so the garbage collection always succeeds.
  */
 #ifndef NON_VOLATILE_SENTRY
 #define NON_VOLATILE_SENTRY
 
+// ENABLE_TLS defines the size of the settings record
+#include "crypto_consts.h"
+// Every settings field is stored as a record of its own
+#include "settings_schema.h"
+
 #include <pico/stdlib.h>
 
+/* Pages taken by a record, the 16-byte header included */
+#define NON_VOL_RECORD_PAGES(length) (((length) + 16 + 255) / 256)
+/* Pages of a settings field in both slots, the value has no null terminator */
+#define NON_VOL_FIELD_PAGES(name, size, layer, input, label)                   \
+  +NON_VOL_SETTINGS_SLOTS * NON_VOL_RECORD_PAGES((size)-1)
+
 enum {
   NON_VOL_SEGMENT_SIZE = 4096,
   NON_VOL_PAGE_SIZE = 256,
+  /* Settings fields and headers are stored twice, see runtime_settings.c */
+  NON_VOL_SETTINGS_SLOTS = 2,
+  /* Largest record of the slot headers, the active marker, the wifi cache and
+   * the DHCP leases, checked where they are written */
+  NON_VOL_SMALL_RECORD_MAX = 240,
+#if ENABLE_TLS
+  NON_VOL_CERTS = 3,
+  NON_VOL_CERT_RECORD_MAX = 2048,
+  NON_VOL_RECORD_MAX = NON_VOL_CERT_RECORD_MAX,
+#else
+  NON_VOL_CERTS = 0,
+  NON_VOL_CERT_RECORD_MAX = 0,
+  NON_VOL_RECORD_MAX = NON_VOL_SMALL_RECORD_MAX,
+#endif
+  /* Worst-case live set: every settings field in both slots, the 5 small
+   * records and the certs */
+  NON_VOL_LIVE_PAGES =
+      0 SETTINGS_SCHEMA(NON_VOL_FIELD_PAGES) +
+      5 * NON_VOL_RECORD_PAGES(NON_VOL_SMALL_RECORD_MAX) +
+      NON_VOL_CERTS * NON_VOL_RECORD_PAGES(NON_VOL_CERT_RECORD_MAX),
+  /* A block holds the live set and one new record of the largest size */
+  NON_VOL_BLOCK_SEGMENTS =
+      ((NON_VOL_LIVE_PAGES + NON_VOL_RECORD_PAGES(NON_VOL_RECORD_MAX)) *
+           NON_VOL_PAGE_SIZE +
+       NON_VOL_SEGMENT_SIZE - 1) /
+      NON_VOL_SEGMENT_SIZE,
+  NON_VOL_BLOCK_SIZE = NON_VOL_SEGMENT_SIZE * NON_VOL_BLOCK_SEGMENTS,
+  NON_VOL_BLOCKS = 4,
+  NON_VOL_REGION_SIZE = NON_VOL_BLOCK_SIZE * NON_VOL_BLOCKS,
+};
+
+/* Keys of the records stored in the journal */
+enum {
+  NON_VOL_KEY_WIFI_CACHE = 1,        ///< wifi_join_cache_t
+  NON_VOL_KEY_SETTINGS_HEADER = 2,   ///< settings_header_t of slot A
+  NON_VOL_KEY_SETTINGS_HEADER_B = 3, ///< settings_header_t of slot B
+  NON_VOL_KEY_SETTINGS_ACTIVE = 4,   ///< Active settings slot, uint8_t
+  NON_VOL_KEY_CA_CERT = 5,           ///< PEM with the null terminator
+  NON_VOL_KEY_CLIENT_CERT = 6,       ///< PEM with the null terminator
+  NON_VOL_KEY_CLIENT_KEY = 7,        ///< PEM with the null terminator
+  NON_VOL_KEY_DHCP_LEASES = 8,       ///< MACs of the portal DHCP leases
+  NON_VOL_FIXED_KEYS = NON_VOL_KEY_DHCP_LEASES,
+  /* Keys of single tls_mqtt_settings fields have this bit set, see
+   * runtime_settings.c */
+  NON_VOL_KEY_FIELD = 0x8000,
+};
+
+#define NON_VOL_COUNT_FIELD(name, size, layer, input, label) +1
+enum {
+  /* Distinct keys kept in the RAM index: the fixed keys and every settings
+   * field in both slots */
+  NON_VOL_MAX_KEYS = NON_VOL_FIXED_KEYS +
+                     NON_VOL_SETTINGS_SLOTS *
+                         (0 SETTINGS_SCHEMA(NON_VOL_COUNT_FIELD)),
 };
 
 /**
- * @brief Reads data from non-volatile memory into a buffer.
+ * @brief Header preceding every record in the journal.
+ */
+typedef struct {
+  uint32_t magic;  ///< NON_VOL_RECORD_MAGIC, start of a record
+  uint32_t seq;    ///< Sequence number, the highest one is the newest
+  uint16_t key;    ///< Key of the record
+  uint16_t length; ///< Length of the data following the header
+  uint32_t crc;    ///< CRC32 of the header (with crc = 0) and the data
+} non_vol_record_t;
+
+#define NON_VOL_RECORD_MAGIC 0x4C4E5652 // "RVNL"
+
+/**
+ * @brief Reads the newest valid record of a key into a buffer.
  *
- * This function reads a specified length of data from non-volatile memory,
- * starting at the calculated offset based on the flash memory size and the
- * required segments. The data is copied into the provided buffer.
+ * The journal is scanned through XIP on the first access, only records with a
+ * valid CRC are considered. The newest record of every key is indexed in RAM
+ * afterwards.
  *
+ * @param[in]  key    Key of the record.
  * @param[out] buffer A pointer to the buffer where the data will be copied.
- * @param[in]  length The length of the data to be read in bytes.
+ * @param[in]  length Size of the buffer in bytes.
  *
- * @note
- * - The function calculates the starting address for reading based on the
- * number of segments required for the data length and the flash memory layout.
- * - Debug messages include the number of segments and the read start address.
+ * @return
+ * - Length of the record on success, at most `length` bytes are copied.
+ * - `-1` if there is no valid record for the key.
  */
-void read_from_non_volatile(uint8_t *buffer, uint16_t length);
+int read_from_non_volatile(uint16_t key, uint8_t *buffer, uint16_t length);
 /**
- * @brief Writes data to non-volatile memory.
+ * @brief Appends a record to the journal.
  *
- * This function writes a specified length of data to non-volatile memory. The
- * memory area is erased before writing to ensure a clean write operation.
- * Critical sections are protected to prevent interference during the write
- * process.
+ * The previous record of the key stays valid until the new one is completely
+ * programmed. A block is erased only when the write position moves into a new
+ * block.
  *
+ * @param[in] key    Key of the record.
  * @param[in] data   A pointer to the data to be written to non-volatile memory.
  * @param[in] length The length of the data to be written in bytes.
  *
  * @return
  * - `0` on success.
- * - A negative value if an error occurs (e.g., during flash programming).
+ * - `-1` if the record is larger than NON_VOL_RECORD_MAX.
+ * - `-2` if there is no space left after garbage collection, only if more
+ * keys are live than the blocks are sized for.
+ * - `-3` if the key does not fit into the index (NON_VOL_MAX_KEYS).
  *
  * @note
- * - The function calculates the starting address for writing based on the
- * number of segments required for the data length and the flash memory layout.
- * - Flash memory is erased in segments and programmed in pages.
- * - The function disables interrupts and prevents multicore interference during
- * the critical section.
- * - Debug messages include details such as the number of segments, the starting
- * address, and the number of pages.
+ * - Interrupts are disabled and the other core is locked out for every page
+ * program and segment erase separately, not for the whole write. Each
+ * operation waits for the transaction of the sensor core to end, see
+ * non_volatile_hold_writes().
+ */
+int write_in_non_volatile(uint16_t key, const uint8_t *data, uint16_t length);
+/**
+ * @brief Returns a pointer to the data of the newest record of a key in the
+ * XIP-mapped flash.
+ *
+ * @param[in]  key    Key of the record.
+ * @param[out] length Length of the record. May be NULL.
+ *
+ * @return A pointer to the data or `NULL` if there is no record for the key.
+ *
+ * @warning The pointer is valid until the next write_in_non_volatile call,
+ * garbage collection may move or erase the record.
+ */
+const uint8_t *map_non_volatile(uint16_t key, uint16_t *length);
+/**
+ * @brief Starts a timing-critical transaction on the sensor core.
+ *
+ * Flash operations lock the sensor core out, as it runs from the XIP-mapped
+ * flash. Between this call and non_volatile_release_writes() no erase or page
+ * program is started, a pending one delays the call by one operation (a page
+ * program or a segment erase) at most. DMA reading only RAM, like the DHT
+ * acquisition chain, keeps running through the operations.
+ *
+ * @note Must not be called by the core writing into the flash.
+ */
+void non_volatile_hold_writes();
+/**
+ * @brief Ends the transaction started by non_volatile_hold_writes().
+ */
+void non_volatile_release_writes();
+/**
+ * @brief Reads data stored by the firmware versions before the journal: a
+ * plain copy at the end of the flash.
+ *
+ * The copy is not a journal record. It lies in the last journal block, which
+ * is erased only after the first block is full, so it is read before the
+ * first save of the migrated data overwrites it.
+ *
+ * @param[out] buffer A pointer to the buffer where the data will be copied.
+ * @param[in]  length The length of the data to be read in bytes.
  */
-int write_in_non_volatile(const uint8_t *data, uint16_t length);
+void read_legacy_from_non_volatile(uint8_t *buffer, uint16_t length);
 
 #endif // NON_VOLATILE_SENTRY
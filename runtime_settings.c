@@ -1,22 +1,28 @@
 #include "runtime_settings.h"
+#include "crc32.h"
 #include "crypto_consts.h"
 #include "non_volatile.h"
 #include "utility.h"
 
+#include <assert.h>
 #include <pico/stdlib.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-/* Global array used for addressing tls_mqtt_settings fields by name */
-static const field_info_t fields[] = {
-    FIELD_ENTRY(tls_mqtt_settings, wifi_ssid),
-    FIELD_ENTRY(tls_mqtt_settings, wifi_pass),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_broker_hostname),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_broker_port),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_broker_CN),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_client_id),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_client_name),
-    FIELD_ENTRY(tls_mqtt_settings, tls_mqtt_client_password),
-};
+/* Global array used for addressing tls_mqtt_settings fields by name. Every
+ * field is stored in the flash as a separate record keyed by its name */
+#define SETTINGS_FIELD(name, size, layer, input, label)                        \
+  {#name, offsetof(tls_mqtt_settings, name),                                   \
+   sizeof(((tls_mqtt_settings *)0)->name), SETTINGS_LAYER_##layer},
+static const field_info_t fields[] = {SETTINGS_SCHEMA(SETTINGS_FIELD)};
+#undef SETTINGS_FIELD
+
+/* The journal blocks are sized from the largest record of every key */
+#define SETTINGS_FIELD_CHECK(name, size, layer, input, label)                  \
+  static_assert((size)-1 <= NON_VOL_RECORD_MAX,                                \
+                "Field " #name " is larger than a journal record");
+SETTINGS_SCHEMA(SETTINGS_FIELD_CHECK)
+#undef SETTINGS_FIELD_CHECK
 
 const field_info_t *get_settings_fields() { return fields; }
 
@@ -24,38 +30,372 @@ uint8_t get_settings_fields_count() {
   return sizeof(fields) / sizeof(fields[0]);
 }
 
+/* Layout before the journal, SETTINGS_VERSION is the current one */
+#define SETTINGS_VERSION_LEGACY 1 // settings_v1_t copied to the end of flash
+
+/* Header committing a set of field records, written after the fields */
+typedef struct {
+  uint16_t version; // SETTINGS_VERSION the fields were written with
+  uint16_t fields;  // Number of field records covered by the CRC
+  uint32_t length;  // Total length of the field values
+  uint32_t crc;     // CRC32 of the key, length and value of every field
+} settings_header_t;
+
+/* Layout of tls_mqtt_settings stored as a whole (version 1). Frozen, must not
+ * follow the changes of tls_mqtt_settings */
+#define SETTINGS_V1_FLAG 0xA5A5A5
+typedef struct {
+  int flag;
+  char wifi_ssid[33];
+  char wifi_pass[64];
+  char tls_mqtt_broker_hostname[200];
+  char tls_mqtt_broker_port[6];
+  char tls_mqtt_broker_CN[200];
+  char tls_mqtt_client_id[100];
+  char tls_mqtt_client_name[100];
+  char tls_mqtt_client_password[100];
+#if ENABLE_TLS
+  char ca_cert[CA_CERT_SIZE];
+  char client_cert[CLIENT_CERT_SIZE];
+  char client_key[CLIENT_KEY_SIZE];
+#endif // !ENABLE_TLS
+  int end_flag;
+} settings_v1_t;
+
+static_assert(sizeof(settings_header_t) <= NON_VOL_SMALL_RECORD_MAX,
+              "The journal blocks are sized for smaller settings records");
+/* The legacy copy has to survive until the migrated settings are saved, it is
+ * erased with the last journal block */
+static_assert((sizeof(settings_v1_t) + NON_VOL_SEGMENT_SIZE - 1) /
+                      NON_VOL_SEGMENT_SIZE * NON_VOL_SEGMENT_SIZE <=
+                  NON_VOL_BLOCK_SIZE,
+              "The legacy settings do not fit into the last journal block");
+#if ENABLE_TLS
+static_assert(CA_CERT_SIZE <= NON_VOL_CERT_RECORD_MAX &&
+                  CLIENT_CERT_SIZE <= NON_VOL_CERT_RECORD_MAX &&
+                  CLIENT_KEY_SIZE <= NON_VOL_CERT_RECORD_MAX &&
+                  (int)SETTINGS_CERTS == (int)NON_VOL_CERTS,
+              "The journal blocks are sized for smaller certs");
+#endif // !ENABLE_TLS
+static_assert(NON_VOL_MAX_KEYS >=
+                  NON_VOL_FIXED_KEYS +
+                      NON_VOL_SETTINGS_SLOTS * ARRAY_LENGTH(fields),
+              "The journal index has no room for the keys of the settings");
+
+static const field_info_t fields_v1[] = {
+    FIELD_ENTRY(settings_v1_t, wifi_ssid),
+    FIELD_ENTRY(settings_v1_t, wifi_pass),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_broker_hostname),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_broker_port),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_broker_CN),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_client_id),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_client_name),
+    FIELD_ENTRY(settings_v1_t, tls_mqtt_client_password),
+#if ENABLE_TLS
+    FIELD_ENTRY(settings_v1_t, ca_cert),
+    FIELD_ENTRY(settings_v1_t, client_cert),
+    FIELD_ENTRY(settings_v1_t, client_key),
+#endif // !ENABLE_TLS
+};
+
+#if ENABLE_TLS
+/* Certs are stored outside of the slots with the null terminator, so they are
+ * parsed in place from the XIP-mapped flash */
+static const struct {
+  uint16_t key;
+  uint16_t size;
+  const char *default_value;
+} certs[SETTINGS_CERTS] = {
+    [SETTINGS_CA_CERT] = {NON_VOL_KEY_CA_CERT, CA_CERT_SIZE, CA_CERT},
+    [SETTINGS_CLIENT_CERT] = {NON_VOL_KEY_CLIENT_CERT, CLIENT_CERT_SIZE,
+                              CLIENT_CERT},
+    [SETTINGS_CLIENT_KEY] = {NON_VOL_KEY_CLIENT_KEY, CLIENT_KEY_SIZE,
+                             CLIENT_KEY},
+};
+#endif // !ENABLE_TLS
+
+/* Fields and the header are stored twice. A save goes into the inactive slot
+ * and the active-slot marker is written last, so the previous settings stay
+ * complete until the new ones are */
+#define SETTINGS_SLOTS NON_VOL_SETTINGS_SLOTS
+#define SETTINGS_SLOT_BIT 0x4000
+static uint8_t active_slot = 0;
+
+/* Journal key of a field in slot 0. Derived from the name (FNV-1a), so
+ * reordering or adding fields keeps the stored values */
+static uint16_t field_key(const field_info_t *field) {
+  uint32_t hash = 2166136261u;
+  for (const char *c = field->field_name; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return NON_VOL_KEY_FIELD | ((hash ^ (hash >> 15)) & 0x7FFF);
+}
+
+static uint16_t slot_field_key(const field_info_t *field, uint8_t slot) {
+  return field_key(field) ^ (slot ? SETTINGS_SLOT_BIT : 0);
+}
+
+static uint16_t slot_header_key(uint8_t slot) {
+  return slot ? NON_VOL_KEY_SETTINGS_HEADER_B : NON_VOL_KEY_SETTINGS_HEADER;
+}
+
+#ifdef DEBUG
+static void assert_unique_field_keys() {
+  for (uint8_t i = 0; i < ARRAY_LENGTH(fields); i++) {
+    for (uint8_t j = i + 1; j < ARRAY_LENGTH(fields); j++) {
+      // Keys of both slots must not collide either
+      assert((field_key(&fields[i]) & ~SETTINGS_SLOT_BIT) !=
+             (field_key(&fields[j]) & ~SETTINGS_SLOT_BIT));
+    }
+  }
+}
+#endif
+
+/* Adds a field value to the header, the same way for the RAM and the flash.
+ * The slot 0 key is used, so the CRC does not depend on the slot */
+static void header_add_field(settings_header_t *header,
+                             const field_info_t *field, const uint8_t *value,
+                             uint16_t length) {
+  uint16_t key = field_key(field);
+  header->crc = crc32_update(header->crc, &key, sizeof(key));
+  header->crc = crc32_update(header->crc, &length, sizeof(length));
+  header->crc = crc32_update(header->crc, value, length);
+  header->fields++;
+  header->length += length;
+}
+
+/* Copies the stored value of a field into settings. Returns true if the field
+ * is stored in the flash */
+static bool read_field(tls_mqtt_settings *settings, const field_info_t *field,
+                       uint8_t slot, settings_header_t *header) {
+  uint16_t length;
+  const uint8_t *data = map_non_volatile(slot_field_key(field, slot), &length);
+  if (data == NULL) {
+    return false;
+  }
+  // The CRC covers the record even if it is unusable
+  header_add_field(header, field, data, length);
+  // Value should leave space for the null terminator
+  if (length >= field->size) {
+    return false;
+  }
+  char *value = (char *)settings + field->offset;
+  memcpy(value, data, length);
+  value[length] = 0;
+  return true;
+}
+
+/* Assembles the settings of a slot and checks them against its header.
+ * Returns 0 on success, 2 if the slot has no header and 3 if it is invalid */
+static int read_slot(tls_mqtt_settings *settings, uint8_t slot) {
+  settings_header_t header;
+  int header_length = read_from_non_volatile(
+      slot_header_key(slot), (uint8_t *)&header, sizeof(header));
+  // Fields absent in the flash keep the default values
+  initialize_default_settings(settings);
+  settings_header_t computed = {0};
+  for (uint8_t i = 0; i < ARRAY_LENGTH(fields); i++) {
+    read_field(settings, &fields[i], slot, &computed);
+  }
+  // Fields of a first save torn before its header are not committed
+  if (header_length < 0) {
+    return 2;
+  }
+  /* Settings of another firmware or a torn save are not guessed at */
+  if (header_length != sizeof(header) || header.version != SETTINGS_VERSION) {
+    DEBUG_PRINT("Unknown settings header in slot %d\n", slot);
+    return 3;
+  }
+  if (computed.crc != header.crc || computed.fields != header.fields ||
+      computed.length != header.length) {
+    DEBUG_PRINT("Settings CRC mismatch in slot %d\n", slot);
+    return 3;
+  }
+  return 0;
+}
+
+#if ENABLE_TLS
+const char *get_settings_cert(settings_cert_t cert, uint16_t *length) {
+  assert(cert < SETTINGS_CERTS);
+  uint16_t stored_length;
+  const char *value =
+      (const char *)map_non_volatile(certs[cert].key, &stored_length);
+  if (value == NULL || stored_length == 0 || value[stored_length - 1] != 0) {
+    value = certs[cert].default_value;
+    stored_length = strlen(value) + 1;
+  }
+  if (length != NULL) {
+    *length = stored_length;
+  }
+  return value;
+}
+
+int write_settings_cert(settings_cert_t cert, const char *value) {
+  assert(cert < SETTINGS_CERTS);
+  uint16_t length = strnlen(value, certs[cert].size);
+  if (length == certs[cert].size) {
+    DEBUG_PRINT("Cert %d is too long\n", cert);
+    return 1;
+  }
+  uint16_t stored_length;
+  const char *stored = get_settings_cert(cert, &stored_length);
+  if (stored_length == length + 1 && memcmp(stored, value, length) == 0) {
+    return 0;
+  }
+  int res = write_in_non_volatile(certs[cert].key, (const uint8_t *)value,
+                                  length + 1);
+  if (res) {
+    DEBUG_PRINT("Error writing cert %d to flash: %d\n", cert, res);
+    return 2;
+  }
+  return 0;
+}
+#endif // !ENABLE_TLS
+
+/* Copies fields matched by name from a struct of an older layout */
+static void migrate_fields(tls_mqtt_settings *settings, const void *old,
+                           const field_info_t *old_fields, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    for (uint8_t j = 0; j < ARRAY_LENGTH(fields); j++) {
+      if (strcmp(old_fields[i].field_name, fields[j].field_name)) {
+        continue;
+      }
+      const char *value = (const char *)old + old_fields[i].offset;
+      uint16_t length = strnlen(value, old_fields[i].size);
+      if (length < fields[j].size) {
+        char *dst = (char *)settings + fields[j].offset;
+        memcpy(dst, value, length);
+        dst[length] = 0;
+      }
+    }
+  }
+}
+
+/* Reads settings_v1_t from the plain copy at the end of the flash */
+static int read_settings_v1(tls_mqtt_settings *settings) {
+  // Used once per migration, not worth keeping in RAM
+  settings_v1_t *old = malloc(sizeof(settings_v1_t));
+  if (old == NULL) {
+    DEBUG_PRINT("Cannot allocate memory for the settings migration\n");
+    return 3;
+  }
+  int res = 0;
+  read_legacy_from_non_volatile((uint8_t *)old, sizeof(settings_v1_t));
+  if (old->flag != SETTINGS_V1_FLAG) {
+    DEBUG_PRINT("settings was not written to flash yet\n");
+    res = 2;
+  } else if (old->flag != old->end_flag) {
+    DEBUG_PRINT("Data on flash is invalid\n");
+    res = 3;
+  } else {
+    DEBUG_PRINT("Migrating settings of version %d\n", SETTINGS_VERSION_LEGACY);
+    migrate_fields(settings, old, fields_v1, ARRAY_LENGTH(fields_v1));
+#if ENABLE_TLS
+    write_settings_cert(SETTINGS_CA_CERT, old->ca_cert);
+    write_settings_cert(SETTINGS_CLIENT_CERT, old->client_cert);
+    write_settings_cert(SETTINGS_CLIENT_KEY, old->client_key);
+#endif // !ENABLE_TLS
+  }
+  free(old);
+  return res;
+}
+
 int read_settings_from_flash(tls_mqtt_settings *settings) {
   if (settings == NULL) {
     DEBUG_PRINT("read_settings_from_flash NULL pointer provided\n");
     return 1;
   }
-  read_from_non_volatile((uint8_t *)settings, sizeof(tls_mqtt_settings));
-  if (settings->flag != SETTINGS_FLAG) {
-    DEBUG_PRINT("settings was not written to flash yet\n");
-    return 2;
+#ifdef DEBUG
+  assert_unique_field_keys();
+#endif
+  uint8_t marker = 0;
+  // Settings written before the slots are in slot 0
+  if (read_from_non_volatile(NON_VOL_KEY_SETTINGS_ACTIVE, &marker, 1) < 0 ||
+      marker >= SETTINGS_SLOTS) {
+    marker = 0;
   }
-  if (settings->flag != settings->end_flag) {
-    DEBUG_PRINT("Data on flash is invalid\n");
-    return 3;
+  active_slot = marker;
+  int res = read_slot(settings, active_slot);
+  if (res == 3) {
+    // The previous settings are complete even if the active ones are not
+    uint8_t other = (active_slot + 1) % SETTINGS_SLOTS;
+    if (read_slot(settings, other) == 0) {
+      DEBUG_PRINT("Falling back to the settings in slot %d\n", other);
+      active_slot = other;
+      res = 0;
+    }
   }
-  DEBUG_PRINT("Enabled settings from the flash\n");
-  return 0;
+  if (res != 2) {
+    return res;
+  }
+  res = read_settings_v1(settings);
+  if (res == 0) {
+    // Store the settings in the current layout
+    write_settings_in_flash(settings);
+  }
+  return res;
 }
 
-void write_settings_in_flash(tls_mqtt_settings *settings) {
+int write_settings_in_flash(tls_mqtt_settings *settings) {
   if (settings == NULL) {
     DEBUG_PRINT("Cannot write NULL to flash\n");
-    return;
+    return 1;
+  }
+  uint8_t slot = (active_slot + 1) % SETTINGS_SLOTS;
+  settings_header_t header = {.version = SETTINGS_VERSION};
+  uint8_t changed = 0;
+  for (uint8_t i = 0; i < ARRAY_LENGTH(fields); i++) {
+    const field_info_t *field = &fields[i];
+    const char *value = (const char *)settings + field->offset;
+    uint16_t length = strnlen(value, field->size - 1);
+    header_add_field(&header, field, (const uint8_t *)value, length);
+    uint16_t key = slot_field_key(field, slot);
+    uint16_t stored_length;
+    const uint8_t *stored = map_non_volatile(key, &stored_length);
+    // Only the fields that differ from the slot are appended
+    if (stored != NULL && stored_length == length &&
+        memcmp(stored, value, length) == 0) {
+      continue;
+    }
+    int res = write_in_non_volatile(key, (const uint8_t *)value, length);
+    if (res) {
+      DEBUG_PRINT("Error writing %s to flash: %d\n", field->field_name, res);
+      return 2;
+    }
+    changed++;
+  }
+  // The header commits the fields of the slot, the marker switches the slots
+  int res = write_in_non_volatile(slot_header_key(slot),
+                                  (const uint8_t *)&header, sizeof(header));
+  if (res == 0) {
+    res = write_in_non_volatile(NON_VOL_KEY_SETTINGS_ACTIVE, &slot, 1);
+  }
+  if (res) {
+    DEBUG_PRINT("Error committing settings slot %d: %d\n", slot, res);
+    return 2;
   }
-  settings->flag = SETTINGS_FLAG;
-  settings->end_flag = SETTINGS_FLAG;
-  write_in_non_volatile((const uint8_t *)settings, sizeof(tls_mqtt_settings));
+  active_slot = slot;
+  DEBUG_PRINT("Settings written to slot %d, %d fields changed\n", slot,
+              changed);
+  return 0;
+}
+
+uint8_t settings_diff_layers(const tls_mqtt_settings *running,
+                             const tls_mqtt_settings *updated) {
+  uint8_t layers = 0;
+  for (uint8_t i = 0; i < get_settings_fields_count(); i++) {
+    const field_info_t *field = &fields[i];
+    if (strncmp((const char *)running + field->offset,
+                (const char *)updated + field->offset, field->size) != 0) {
+      layers |= field->layer;
+    }
+  }
+  return layers;
 }
 
 void initialize_default_settings(tls_mqtt_settings *settings) {
   assert(settings != NULL);
   static const tls_mqtt_settings temp_static = {
-      .flag = 123456,
       .wifi_ssid = WIFI_SSID,
       .wifi_pass = WIFI_PASSWORD,
       .tls_mqtt_broker_hostname = MQTT_SERVER_HOST,
@@ -64,13 +404,6 @@ void initialize_default_settings(tls_mqtt_settings *settings) {
       .tls_mqtt_client_id = PICO_HOSTNAME,
       .tls_mqtt_client_name = TLS_MQTT_CLIENT_NAME,
       .tls_mqtt_client_password = TLS_MQTT_CLIENT_PASS,
-#if ENABLE_TLS
-      .ca_cert = CA_CERT,
-      .client_cert = CLIENT_CERT,
-      .client_key = CLIENT_KEY,
-#endif                   // !ENABLE_TLS
-      .end_flag = 123456 // end flag should be equal flag that is equal
-                         // SETTINGS_FLAG
   };
   memcpy(settings, &temp_static, sizeof(tls_mqtt_settings));
   DEBUG_PRINT("Enable default settings\n");
@@ -7,8 +7,10 @@
 
 // For sizes of the certs
 #include "crypto_consts.h"
-// Control if the flash memory was initialized already
-#define SETTINGS_FLAG 0xA5A5A5
+#include "settings_schema.h"
+/* Layout version of the stored settings. Increment when a field is removed or
+ * changes meaning and add the migration to runtime_settings.c */
+#define SETTINGS_VERSION 2
 
 /**
  * @brief Structure to store metadata about configuration fields.
@@ -21,6 +23,7 @@ typedef struct {
   const char *field_name;
   uint16_t offset;
   uint16_t size;
+  uint8_t layer; // settings_layer_t restarted on a change, 0 for old layouts
 } field_info_t;
 /* Auxiliary macro for initializing a corresponding array of fields */
 #define FIELD_ENTRY(struct_type, field)                                        \
@@ -41,33 +44,54 @@ const field_info_t *get_settings_fields();
  * @return Number of field descriptors as an unsigned 8-bit integer.
  */
 uint8_t get_settings_fields_count();
+/**
+ * @brief Finds a field descriptor by the field name.
+ *
+ * The lookup is a perfect hash generated at compile time from
+ * settings_schema.h (settings_lookup.cpp): one hash of the name and one string
+ * comparison regardless of the number of fields.
+ *
+ * @param[in] name Null-terminated field name.
+ *
+ * @return Index into get_settings_fields(), `-1` if no field has the name.
+ */
+int find_settings_field(const char *name);
+
+/* Connection layers a settings field belongs to. Changing a field restarts
+ * its layer and the layers above it */
+typedef enum {
+  SETTINGS_LAYER_WIFI = 1 << 0,   // STA association
+  SETTINGS_LAYER_BROKER = 1 << 1, // DNS lookup, TLS and TCP connection
+  SETTINGS_LAYER_CLIENT = 1 << 2, // MQTT session credentials
+} settings_layer_t;
 
-/* Struct to store network settings */
+/* Struct to store network settings, the fields are listed in
+ * settings_schema.h */
+#define SETTINGS_MEMBER(name, size, layer, input, label) char name[size];
 typedef struct {
-  int flag; // Set to SETTINGS_FLAG before saving into the flash
-  char wifi_ssid[33];
-  char wifi_pass[64];
-  char tls_mqtt_broker_hostname[200];
-  char tls_mqtt_broker_port[6];
-  char tls_mqtt_broker_CN[200];
-  char tls_mqtt_client_id[100];
-  char tls_mqtt_client_name[100];
-  char tls_mqtt_client_password[100];
-#if ENABLE_TLS
-  char ca_cert[CA_CERT_SIZE];
-  char client_cert[CLIENT_CERT_SIZE];
-  char client_key[CLIENT_KEY_SIZE];
-#endif          // !ENABLE_TLS
-  int end_flag; // end flag should be equal flag that is equal SETTINGS_FLAG
-                // after the struct is recorded in the flash. It is a simple
-                // check for data validness.
+  SETTINGS_SCHEMA(SETTINGS_MEMBER)
 } tls_mqtt_settings;
+#undef SETTINGS_MEMBER
+
+#if ENABLE_TLS
+/* Certs are kept in the flash only, see get_settings_cert */
+typedef enum {
+  SETTINGS_CA_CERT,
+  SETTINGS_CLIENT_CERT,
+  SETTINGS_CLIENT_KEY,
+  SETTINGS_CERTS, // Number of certs
+} settings_cert_t;
+#endif // !ENABLE_TLS
 /**
  * @brief Reads MQTT settings from non-volatile flash memory.
  *
- * This function reads `tls_mqtt_settings` from flash memory and validates its
- * integrity using a predefined flag. If the settings are invalid or have not
- * been written to flash memory, appropriate error codes are returned.
+ * Every field listed by get_settings_fields() is stored as a separate flash
+ * record in one of two slots. A header record written after the fields holds
+ * the layout version, the number and total length of the fields and a CRC32
+ * over them. The structure is assembled from the default settings overlaid
+ * with the newest stored value of every field of the active slot and checked
+ * against the header, the other slot is used if the check fails. Settings of
+ * older layouts are migrated field by field and stored in the current layout.
  *
  * @param[out] settings A pointer to a `tls_mqtt_settings` structure that will
  * be populated with the settings read from flash memory. The memory for this
@@ -77,31 +101,74 @@ typedef struct {
  *   - `0` on success.
  *   - `1` if a `NULL` pointer is provided.
  *   - `2` if the settings have not been written to flash memory yet.
- *   - `3` if the data on flash memory is invalid.
- *
- * @note
- * - The function uses a predefined flag (`SETTINGS_FLAG`) to verify the
- * validity of the settings.
+ *   - `3` if the data on flash memory is invalid: CRC mismatch in both slots
+ *   or a layout other than SETTINGS_VERSION.
  */
 int read_settings_from_flash(tls_mqtt_settings *settings);
 /**
  * @brief Writes MQTT settings to non-volatile flash memory.
  *
- * This function writes the provided `tls_mqtt_settings` structure to flash
- * memory. It ensures the validity of the data by setting the `flag` and
- * `end_flag` fields to a predefined value (`SETTINGS_FLAG`).
+ * The settings are written into the inactive slot: the fields that differ
+ * from the values stored in the slot, then the header. The active-slot marker
+ * is switched last, so a failed or torn save keeps the previous settings.
  *
  * @param[in] settings A pointer to a `tls_mqtt_settings` structure containing
  * the settings to be written to flash memory.
+ *
+ * @return
+ *   - `0` on success.
+ *   - `1` if a `NULL` pointer is provided.
+ *   - `2` if a flash write failed, the previous settings stay active.
+ */
+int write_settings_in_flash(tls_mqtt_settings *settings);
+#if ENABLE_TLS
+/**
+ * @brief Returns a cert in PEM format without copying it into RAM.
+ *
+ * The pointer refers to the record in the XIP-mapped flash or to the
+ * compile-time default if no cert has been stored.
+ *
+ * @param[in]  cert   The cert to return.
+ * @param[out] length Length of the cert including the null terminator, as
+ * mbedTLS expects for PEM. May be NULL.
+ *
+ * @return A pointer to the null-terminated cert.
+ *
+ * @warning The pointer is valid until the next flash write, parse or copy the
+ * cert before saving any settings.
+ */
+const char *get_settings_cert(settings_cert_t cert, uint16_t *length);
+/**
+ * @brief Stores a cert in the flash if it differs from the current one.
+ *
+ * @param[in] cert  The cert to store.
+ * @param[in] value Null-terminated cert in PEM format, must not point into the
+ * flash.
+ *
+ * @return
+ *   - `0` on success.
+ *   - `1` if the cert does not fit into CA_CERT_SIZE/CLIENT_CERT_SIZE/
+ *   CLIENT_KEY_SIZE.
+ *   - `2` if the flash write failed.
+ */
+int write_settings_cert(settings_cert_t cert, const char *value);
+#endif // !ENABLE_TLS
+/**
+ * @brief Compares two sets of settings field by field.
+ *
+ * @param[in] running Settings currently in use.
+ * @param[in] updated New settings.
+ *
+ * @return Bitmask of settings_layer_t with a changed field, `0` if the
+ * settings are equal.
  */
-void write_settings_in_flash(tls_mqtt_settings *settings);
+uint8_t settings_diff_layers(const tls_mqtt_settings *running,
+                             const tls_mqtt_settings *updated);
 /**
  * @brief Initializes MQTT settings with default values.
  *
  * This function populates the provided `tls_mqtt_settings` structure with
- * default values for Wi-Fi and MQTT configuration. It ensures that all fields
- * are set appropriately, including the `flag` and `end_flag` fields used for
- * validation.
+ * default values for Wi-Fi and MQTT configuration.
  *
  * @param[out] settings A pointer to a `tls_mqtt_settings` structure to be
  * initialized. The memory for this structure must be allocated by the caller.
@@ -0,0 +1,23 @@
+#include "sample_loss.h"
+
+void sample_loss_init(sample_loss_t *loss, uint32_t period_us) {
+  loss->period_us = period_us;
+  loss->last_time_us = 0;
+  loss->started = false;
+  loss->lost = 0;
+}
+
+uint32_t sample_loss_add(sample_loss_t *loss, uint32_t time_us) {
+  uint32_t missed = 0;
+  if (loss->started) {
+    uint32_t periods = (time_us - loss->last_time_us + loss->period_us / 2) /
+                       loss->period_us;
+    if (periods > 1) {
+      missed = periods - 1;
+      loss->lost += missed;
+    }
+  }
+  loss->started = true;
+  loss->last_time_us = time_us;
+  return missed;
+}
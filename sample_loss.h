@@ -0,0 +1,47 @@
+/*
+ * Accounting of lost periodic samples. A source stamps every sample with the
+ * time it was taken, a gap of more than one period between two stamps is a
+ * lost sample: a stalled source or a ring buffer not collected in time. Free
+ * of the Pico SDK, so the host tests check the DHT timeline with it.
+ */
+#ifndef SAMPLE_LOSS_H_SENTRY
+#define SAMPLE_LOSS_H_SENTRY
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint32_t period_us;
+  uint32_t last_time_us;
+  bool started;
+  uint32_t lost; // Periods without a sample since sample_loss_init()
+} sample_loss_t;
+
+/**
+ * @brief Starts the accounting of a source, the first sample added sets the
+ * reference time.
+ *
+ * @param[out] loss Accounting state.
+ * @param[in] period_us Nominal time between two samples.
+ */
+void sample_loss_init(sample_loss_t *loss, uint32_t period_us);
+/**
+ * @brief Adds the stamp of the next sample of the source, stamps are added in
+ * the order they were taken. A stamp within half a period of the expected one
+ * is on time, the 32 bit microsecond clock may wrap between two stamps.
+ *
+ * @param[in,out] loss Accounting state.
+ * @param[in] time_us Time the sample was taken.
+ * @return Periods lost before this sample, they are added to loss->lost.
+ */
+uint32_t sample_loss_add(sample_loss_t *loss, uint32_t time_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLE_LOSS_H_SENTRY
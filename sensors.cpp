@@ -0,0 +1,350 @@
+/*
+ * Sensor layer. Every entry of sensors_registry.h is a slot of a static tuple
+ * holding the driver object and the topic data. The loops over the sensors
+ * are unrolled at compile time and call the drivers directly, so the calls
+ * can be inlined; drivers of disabled sensors are not compiled in. Driver
+ * state is allocated statically, the C interface of sensors.h is kept.
+ */
+#include "sensors.h"
+#include "adc_sampler.h"
+#include "board_health.h"
+#include "dht.h"
+#include "hardware_config.h"
+#include "sample_loss.h"
+#include "utility.h"
+
+extern "C" {
+#include "ds18b20.h"
+}
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+const char *sensor_topics[NUMBER_OF_SENSOR_TOPICS] = {
+#define SENSOR_TOPIC_NAME(topic, driver, on, label) #topic,
+    SENSORS_REGISTRY(SENSOR_TOPIC_NAME)
+#undef SENSOR_TOPIC_NAME
+};
+
+/* httpd takes SSI tags of LWIP_HTTPD_MAX_TAG_NAME_LEN (8) chars at most */
+#define SENSOR_TAG_CHECK(topic, driver, on, label)                             \
+  static_assert(sizeof(#topic) - 1 <= 8, "Topic " #topic " is too long");
+SENSORS_REGISTRY(SENSOR_TAG_CHECK)
+#undef SENSOR_TAG_CHECK
+
+namespace {
+
+/* Interface of the drivers, <driver>_driver for the driver of a registry
+ * entry. A driver implements collect() and hides the defaults it needs:
+ *   bool init()    - Claims the hardware, false if the sensor is missing.
+ *   void prepare() - Starts a measurement, collected on the next collect().
+ *   bool collect(char *str, uint16_t size) - Writes the JSON of the topic,
+ *                    false if there is nothing new to send.
+ *   void clean()   - Releases the hardware claimed by init().
+ */
+struct sensor_driver {
+  bool init() { return true; }
+  void prepare() {}
+  void clean() {}
+};
+
+/* With DHT_ACQUISITION_PERIOD_MS a DMA chain measures the DHT on its own and
+ * collect() validates the frames of its ring, the newest good one is sent.
+ * Otherwise DHTs are not started by prepare(), prepare_sensors() starts all
+ * of them at once so they share one measurement window. Wait at least 25ms
+ * after prepare_sensors() before collecting data */
+struct dht_sensor_driver : sensor_driver {
+  static constexpr bool autonomous = DHT_ACQUISITION_PERIOD_MS > 0;
+  static constexpr uint32_t period_us = DHT_ACQUISITION_PERIOD_MS * 1000u;
+  dht_t dht;
+  dht_acquisition_t acquisition;
+  sample_loss_t loss;
+
+  /* The chain stamps every frame, sample_loss counts the periods without
+   * one: a stalled chain or a ring not collected in time */
+  void check_lost_frames(const dht_reading_t *readings, uint count) {
+    for (uint i = 0; i < count; i++) {
+      uint32_t missed = sample_loss_add(&loss, readings[i].time_us);
+      if (missed > 0) {
+        DEBUG_PRINT("DHT on pin %d lost %lu frames, %lu since init\n",
+                    dht.data_pin, (unsigned long)missed,
+                    (unsigned long)loss.lost);
+      }
+    }
+  }
+
+  bool collect(char *str, uint16_t size) {
+    dht_reading_t reading;
+    if constexpr (autonomous) {
+      dht_reading_t readings[DHT_ACQUISITION_SLOTS];
+      uint count = dht_collect_acquisition(&acquisition, readings,
+                                           DHT_ACQUISITION_SLOTS);
+      if (count == 0) {
+        return false;
+      }
+      check_lost_frames(readings, count);
+      reading = readings[count - 1];
+      for (uint i = count; i-- > 0;) {
+        if (readings[i].result == DHT_RESULT_OK) {
+          reading = readings[i];
+          break;
+        }
+      }
+    } else {
+      reading.result = dht_finish_measurement_blocking(
+          &dht, &reading.humidity, &reading.temperature_c);
+    }
+    if (reading.result == DHT_RESULT_OK) {
+      snprintf(str, size, "{\"r_humidity\":%.2f,\"r_temperature\":%.2f}",
+               reading.humidity, reading.temperature_c);
+    } else {
+      snprintf(str, size, "{\"r_humidity\":null,\"r_temperature\":null}");
+    }
+    return true;
+  }
+  void clean() {
+    if constexpr (autonomous) {
+      dht_stop_acquisition(&acquisition);
+    }
+    dht_deinit(&dht);
+  }
+};
+
+template <uint8_t DataPin> struct dht_pin_driver : dht_sensor_driver {
+  bool init() {
+    if (!dht_init(&dht, DHT_MODEL, DHT_PIO, DataPin, true)) {
+      DEBUG_PRINT("No free state machine or DMA channel for the DHT\n");
+      return false;
+    }
+    if constexpr (autonomous) {
+      if (!dht_start_acquisition(&dht, &acquisition,
+                                 DHT_ACQUISITION_PERIOD_MS)) {
+        DEBUG_PRINT("No free DMA channels for the DHT acquisition\n");
+        dht_deinit(&dht);
+        return false;
+      }
+      sample_loss_init(&loss, period_us);
+    }
+    return true;
+  }
+};
+
+using dht_driver = dht_pin_driver<DHT_DATA_PIN>;
+using dht2_driver = dht_pin_driver<DHT2_DATA_PIN>;
+
+/* Wait at least 1000ms after prepare() before collecting the data */
+struct ds18b20_driver : sensor_driver {
+  ds18b20_t ds;
+
+  bool init() {
+    int res = ds18b20_init(&ds, DS18B20_PIO, DS18B20_PIN);
+    DEBUG_PRINT("ds18b20-init() return error: %d\n", res);
+    return res == 0;
+  }
+  void prepare() { ds18b20_convert(&ds); }
+  bool collect(char *str, uint16_t size) {
+    if (ds18b20_read_temperature(&ds)) {
+      snprintf(str, size, "{\"w_temp\":null}");
+    } else {
+      snprintf(str, size, "{\"w_temp\":%.2f}", ds.temperature);
+    }
+    return true;
+  }
+  void clean() { ds18b20_deinit(&ds); }
+};
+
+/* Capacitive probe sampled by the ADC sampler, every collect() reads the mean
+ * of the last window in 0-100 % between the calibration points */
+struct moisture_driver : sensor_driver {
+  static constexpr uint input = MOISTURE_PIN - 26;
+  static_assert(MOISTURE_PIN >= 26 && MOISTURE_PIN <= 28,
+                "GPIO 29 is used by the Wi-Fi chip, others have no ADC");
+
+  bool init() { return adc_sampler_enable(input) == 0; }
+  bool collect(char *str, uint16_t size) {
+    float raw;
+    if (adc_sampler_read(input, &raw)) {
+      snprintf(str, size, "{\"moist\":null}");
+      return true;
+    }
+    float moisture = (MOISTURE_DRY_RAW - raw) * 100.0f /
+                     (MOISTURE_DRY_RAW - MOISTURE_WET_RAW);
+    moisture = moisture < 0.0f ? 0.0f : moisture > 100.0f ? 100.0f : moisture;
+    snprintf(str, size, "{\"moist\":%.1f,\"moist_raw\":%.0f}", moisture,
+             raw);
+    return true;
+  }
+  void clean() { adc_sampler_disable(input); }
+};
+
+/* Die temperature from the ADC sampler, VSYS and RSSI sampled by the net core
+ * (board_health.c). Sent when a value moved by more than its deadband since
+ * the last send, not more often than BOARD_HEALTH_MIN_PERIOD_MS and at least
+ * every BOARD_HEALTH_MAX_PERIOD_MS */
+struct board_health_driver : sensor_driver {
+  static constexpr uint input = ADC_SAMPLER_TEMPERATURE_INPUT;
+  bool sent{};
+  uint32_t sent_ms{};
+  bool temp_valid{};
+  float temp_c{};
+  board_health_t health{};
+
+  bool init() { return adc_sampler_enable(input) == 0; }
+  bool collect(char *str, uint16_t size) {
+    float raw;
+    board_health_t now_health;
+    if (board_health_read(&now_health)) {
+      return false;
+    }
+    // The die temperature is missing while the ADC sampling is stopped
+    bool now_temp_valid = adc_sampler_read(input, &raw) == 0;
+    // Sensor voltage is 0.706 V at 27 C and drops 1.721 mV per degree
+    float now_temp_c =
+        now_temp_valid ? 27.0f - (raw * 3.3f / 4096 - 0.706f) / 0.001721f
+                       : 0.0f;
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    uint32_t elapsed_ms = now_ms - sent_ms;
+    bool moved =
+        now_temp_valid != temp_valid ||
+        std::fabs(now_temp_c - temp_c) > BOARD_HEALTH_TEMP_DEADBAND_C ||
+        now_health.vsys_valid != health.vsys_valid ||
+        std::fabs(now_health.vsys_v - health.vsys_v) >
+            BOARD_HEALTH_VSYS_DEADBAND_V ||
+        now_health.rssi_valid != health.rssi_valid ||
+        std::abs(now_health.rssi_dbm - health.rssi_dbm) >
+            BOARD_HEALTH_RSSI_DEADBAND_DBM;
+    if (sent && (elapsed_ms < BOARD_HEALTH_MIN_PERIOD_MS ||
+                 (!moved && elapsed_ms < BOARD_HEALTH_MAX_PERIOD_MS))) {
+      return false;
+    }
+    sent = true;
+    sent_ms = now_ms;
+    temp_valid = now_temp_valid;
+    temp_c = now_temp_c;
+    health = now_health;
+    // Missing values are sent as JSON null
+    char vsys[16] = "null", die_temp[16] = "null", rssi[16] = "null";
+    if (health.vsys_valid) {
+      snprintf(vsys, sizeof(vsys), "%.2f", health.vsys_v);
+    }
+    if (temp_valid) {
+      snprintf(die_temp, sizeof(die_temp), "%.1f", temp_c);
+    }
+    if (health.rssi_valid) {
+      snprintf(rssi, sizeof(rssi), "%ld", (long)health.rssi_dbm);
+    }
+    snprintf(str, size, "{\"vsys\":%s,\"die_temp\":%s,\"rssi\":%s}", vsys,
+             die_temp, rssi);
+    return true;
+  }
+  void clean() { adc_sampler_disable(input); }
+};
+
+template <typename Driver, sensor_topic_t Topic, bool Enabled>
+struct sensor_slot {
+  static constexpr sensor_topic_t topic = Topic;
+  static constexpr bool enabled = Enabled;
+  // Disabled sensors keep no driver state
+  std::conditional_t<Enabled, Driver, sensor_driver> driver{};
+  char topic_data[SENSOR_DATA_SIZE]{};
+  bool connected = false;
+  bool fresh = false; // topic_data is not transferred yet
+};
+
+/* One slot per registry entry, in the order of the topics */
+#define SENSOR_SLOT(topic, driver, on, label)                                  \
+  std::tuple<sensor_slot<driver##_driver, SENSOR_TOPIC_##topic, on>>{},
+using sensors_t =
+    decltype(std::tuple_cat(SENSORS_REGISTRY(SENSOR_SLOT) std::tuple<>{}));
+#undef SENSOR_SLOT
+
+template <size_t... I>
+constexpr bool slots_match_topics(std::index_sequence<I...>) {
+  return ((std::tuple_element_t<I, sensors_t>::topic == I) && ...);
+}
+static_assert(std::tuple_size_v<sensors_t> == NUMBER_OF_SENSOR_TOPICS &&
+                  slots_match_topics(
+                      std::make_index_sequence<NUMBER_OF_SENSOR_TOPICS>()),
+              "Every topic needs its slot at the position of its number");
+
+sensors_t sensors;
+
+template <typename Slot>
+using slot_t = std::remove_reference_t<Slot>;
+
+/* Calls fn for the slot of every enabled sensor */
+template <typename Fn> void for_each_sensor(Fn &&fn) {
+  std::apply(
+      [&](auto &...slot) {
+        (
+            [&](auto &s) {
+              if constexpr (slot_t<decltype(s)>::enabled) {
+                fn(s);
+              }
+            }(slot),
+            ...);
+      },
+      sensors);
+}
+
+} // namespace
+
+void init_sensors() {
+  for_each_sensor([](auto &slot) {
+    slot.connected = slot.driver.init();
+    DEBUG_PRINT("Sensor %s is %s\n", sensor_topics[slot.topic],
+                slot.connected ? "connected" : "disconnected");
+  });
+}
+
+void prepare_sensors() {
+  dht_t *dhts[NUMBER_OF_SENSOR_TOPICS];
+  uint dht_count = 0;
+  for_each_sensor([&](auto &slot) {
+    using driver_t = decltype(slot.driver);
+    if (!slot.connected) {
+      return;
+    }
+    if constexpr (std::is_base_of_v<dht_sensor_driver, driver_t>) {
+      if constexpr (!dht_sensor_driver::autonomous) {
+        dhts[dht_count++] = &slot.driver.dht;
+      }
+    } else {
+      slot.driver.prepare();
+    }
+  });
+  if (dht_count > 0) {
+    dht_start_measurements(dhts, dht_count);
+  }
+}
+
+void collect_data_sensors() {
+  for_each_sensor([](auto &slot) {
+    if (slot.connected) {
+      slot.fresh |=
+          slot.driver.collect(slot.topic_data, sizeof(slot.topic_data));
+    }
+  });
+}
+
+void transfer_data_sensors(transfer_sensor_data_function transfer_fn) {
+  for_each_sensor([&](auto &slot) {
+    if (slot.connected && slot.fresh) {
+      transfer_fn(slot.topic_data, sizeof(slot.topic_data), slot.topic);
+      slot.fresh = false;
+    }
+  });
+}
+
+void deinit_clean_sensors() {
+  for_each_sensor([](auto &slot) {
+    if (slot.connected) {
+      slot.driver.clean();
+      slot.connected = false;
+    }
+  });
+}
@@ -1,59 +1,63 @@
 #ifndef SENSORS_SENTRY_H
 #define SENSORS_SENTRY_H
 
+#include "sensors_registry.h"
+
 #include <pico/stdlib.h>
 #include <stdint.h>
 
-/* Function types used by the sensor */
-/* Returns 0 on success, other values on error */
-typedef uint8_t (*init_function)(void **custom_data);
-typedef void (*auxiliary_function)(void **custom_data);
-typedef void (*collect_function)(char *str, uint16_t size, void **custom_data);
-/* Performs deinitialization of the hardware initialized in corresponding
- * init_function. If necessary deallocates dynamic memory in the custom_data
- * and takes care of dangling pointer of the custom_data.
- */
-typedef void (*clean_function)(void **custom_data);
+/* The sensors are implemented in C++ (sensors.cpp), the interface is C */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Topic numbers, SENSOR_TOPIC_<topic> for every entry of the registry */
+#define SENSOR_TOPIC_ENUM(topic, driver, on, label) SENSOR_TOPIC_##topic,
+typedef enum {
+  SENSORS_REGISTRY(SENSOR_TOPIC_ENUM) NUMBER_OF_SENSOR_TOPICS
+} sensor_topic_t;
+#undef SENSOR_TOPIC_ENUM
+
+/* Topic names indexed by the topic number, used as MQTT topics, SSI tags and
+ * JSON keys */
+extern const char *sensor_topics[NUMBER_OF_SENSOR_TOPICS];
+
+/* Size of the JSON data of a topic */
+#define SENSOR_DATA_SIZE 128
+
+/* Size of a JSON object holding the data of every topic under its name, with
+ * the terminator: "topic": and a separator per topic, the braces */
+#define SENSOR_JSON_KEY_SIZE(topic, driver, on, label) +(sizeof(#topic) + 3)
+#define SENSORS_JSON_SIZE                                                      \
+  (3 + NUMBER_OF_SENSOR_TOPICS * (SENSOR_DATA_SIZE - 1) +                      \
+   (0 SENSORS_REGISTRY(SENSOR_JSON_KEY_SIZE)))
 
 /* Function should be defined in the main program to pass the sensor data
  * to a handler function, other core etc. Used for easier buffering before
  * logging or sharing of the net.
  */
 typedef void (*transfer_sensor_data_function)(const char *str, uint size,
-                                              uint8_t topic_number);
-// Structure used to organize a set of sensors into the same interface
-typedef struct {
-  char topic_name[8];
-  char topic_data[128];
-  void *custom_data;
-  init_function init_fn;
-  auxiliary_function auxiliary_fn;
-  collect_function collect_fn;
-  clean_function clean_fn;
-  bool disconnected;
-} sensor_wrap_t;
+                                              sensor_topic_t topic_number);
 
 /**
- * @brief Initializes all sensors by calling their respective initialization
- * functions.
+ * @brief Initializes all sensors by calling the init of their drivers.
  *
- * This function iterates over the array of sensors, calling their
- * initialization functions. The `disconnected` flag is set based on the result
- * of the initialization.
+ * This function iterates over the sensors of the registry, calling the init of
+ * their drivers. A sensor is disconnected if its init failed, sensors not
+ * enabled in the registry stay disconnected.
  */
 void init_sensors();
 /**
- * @brief Prepares sensors by calling auxiliary functions if necessary.
+ * @brief Prepares sensors by starting their measurements if necessary.
  *
- * This function iterates over the sensor array and invokes auxiliary functions
- * for sensors that are successfully connected and have an auxiliary function
- * defined.
+ * This function iterates over the sensors and invokes the prepare of the
+ * drivers of connected sensors, drivers without it do nothing.
  */
 void prepare_sensors();
 /**
  * @brief Collects data from all connected sensors.
  *
- * This function iterates through the sensor array, collecting data from each
+ * This function iterates through the sensors, collecting data from each
  * sensor that is connected and storing it in the respective topic data field.
  */
 void collect_data_sensors();
@@ -62,18 +66,23 @@ void collect_data_sensors();
  *
  * @param transfer_fn Function pointer to handle the transfer of sensor data.
  *
- * This function iterates through the sensor array and calls the provided
- * transfer function for each connected sensor, passing its topic data, size
- * of the topic data, and topic number.
+ * This function iterates through the sensors and calls the provided
+ * transfer function for each connected sensor with data not transferred yet,
+ * passing its topic data, size of the topic data, and topic number of its
+ * registry entry.
  */
 void transfer_data_sensors(transfer_sensor_data_function transfer_fn);
 
 /**
  * @brief Deinitializes and cleans up all connected sensors.
  *
- * This function iterates over the sensor array and invokes the cleanup function
- * for each connected sensor, releasing any allocated resources.
+ * This function iterates over the sensors and invokes the clean of the driver
+ * of each connected sensor, releasing the hardware it claimed.
  */
 void deinit_clean_sensors();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // SENSORS_SENTRY_H
@@ -0,0 +1,29 @@
+/*
+ * Registry of the sensors, the single list every sensor table is generated
+ * from: the sensor slots of sensors.cpp, the topic enumeration and names used
+ * for MQTT, SSI, SSE and /api/sensors, and the rows of the portal page
+ * (makefsdata.py replaces <!--@sensor_rows--> in the pages). A sensor sends
+ * its data under the topic of its entry, the position in the list.
+ *
+ * X(topic, driver, enabled, label)
+ *   topic   - Topic published under the client ID, also the SSI tag (8 chars
+ *             at most) and the key of the JSON data.
+ *   driver  - Driver class <driver>_driver in sensors.cpp.
+ *   enabled - 1 if the sensor is fitted, 0 keeps the topic without calling the
+ *             driver. Literal 0 or 1, makefsdata.py reads it.
+ *   label   - Label of the row on the portal page.
+ *
+ * makefsdata.py parses the entries with a regular expression, keep one entry
+ * per line in this form.
+ */
+#ifndef SENSORS_REGISTRY_H_SENTRY
+#define SENSORS_REGISTRY_H_SENTRY
+
+#define SENSORS_REGISTRY(X)                                                    \
+  X(room, dht, 1, "Room Humidity and Temperature")                             \
+  X(room2, dht2, 0, "Room 2 Humidity and Temperature")                         \
+  X(w_temp, ds18b20, 0, "Water Temperature")                                   \
+  X(moist, moisture, 1, "Soil Moisture")                                       \
+  X(health, board_health, 1, "Board Health")
+
+#endif // SENSORS_REGISTRY_H_SENTRY
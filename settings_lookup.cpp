@@ -0,0 +1,95 @@
+/*
+ * Perfect hash of the settings field names, generated by the compiler from
+ * settings_schema.h. The FNV-1a hash of a name is scrambled by a multiplier
+ * found at compile time so that no two names share a slot; a lookup is one
+ * hash, one table read and one string comparison.
+ */
+#include "settings_schema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+#define SETTINGS_NAME(name, size, layer, input, label) #name,
+constexpr const char *names[] = {SETTINGS_SCHEMA(SETTINGS_NAME)};
+#undef SETTINGS_NAME
+constexpr size_t names_count = sizeof(names) / sizeof(names[0]);
+static_assert(names_count < INT8_MAX, "Slots hold the field index as int8_t");
+
+constexpr uint32_t fnv1a(const char *name) {
+  uint32_t hash = 2166136261u;
+  while (*name != 0) {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/* At least 4 slots per name keep the multiplier search short */
+constexpr unsigned slot_bits() {
+  unsigned bits = 1;
+  while ((1u << bits) < names_count * 4) {
+    bits++;
+  }
+  return bits;
+}
+constexpr unsigned bits = slot_bits();
+constexpr size_t slots_count = (size_t)1 << bits;
+
+constexpr size_t slot_of(uint32_t hash, uint32_t multiplier) {
+  return (uint32_t)(hash * multiplier) >> (32 - bits);
+}
+
+struct slots_t {
+  int8_t index[slots_count];
+};
+
+/* Fills the slots with the field indices, returns false on a collision */
+constexpr bool fill_slots(uint32_t multiplier, slots_t &slots) {
+  for (size_t i = 0; i < slots_count; i++) {
+    slots.index[i] = -1;
+  }
+  for (size_t i = 0; i < names_count; i++) {
+    size_t slot = slot_of(fnv1a(names[i]), multiplier);
+    if (slots.index[slot] >= 0) {
+      return false;
+    }
+    slots.index[slot] = (int8_t)i;
+  }
+  return true;
+}
+
+/* Returns the first odd multiplier without collisions, 0 if none is found */
+constexpr uint32_t find_multiplier() {
+  for (uint32_t multiplier = 0x9E3779B1u, tries = 0; tries < 4096;
+       multiplier += 2, tries++) {
+    slots_t slots{};
+    if (fill_slots(multiplier, slots)) {
+      return multiplier;
+    }
+  }
+  return 0;
+}
+
+constexpr uint32_t multiplier = find_multiplier();
+static_assert(multiplier != 0, "No perfect hash for the settings field names, "
+                               "two names may have the same FNV-1a hash");
+
+constexpr slots_t make_slots() {
+  slots_t slots{};
+  fill_slots(multiplier, slots);
+  return slots;
+}
+constexpr slots_t slots = make_slots();
+
+} // namespace
+
+extern "C" int find_settings_field(const char *name) {
+  int8_t index = slots.index[slot_of(fnv1a(name), multiplier)];
+  if (index < 0 || strcmp(names[index], name) != 0) {
+    return -1;
+  }
+  return index;
+}
@@ -0,0 +1,46 @@
+/*
+ * Schema of the runtime settings, the single list every settings table is
+ * generated from: the tls_mqtt_settings structure and its field table
+ * (runtime_settings), the name lookup (settings_lookup.cpp) and the inputs of
+ * the AP mode form (makefsdata.py replaces <!--@settings_form--> in the pages).
+ *
+ * X(name, size, layer, input, label)
+ *   name  - Field name, also the flash record key and the form key. Renaming
+ *           a field drops its stored value.
+ *   size  - Size of the char array including the null terminator.
+ *   layer - Connection restarted when the field changes, settings_layer_t
+ *           without the SETTINGS_LAYER_ prefix.
+ *   input - "text", "password" or "number" (digits only).
+ *   label - Label of the form input.
+ *
+ * makefsdata.py parses the entries with a regular expression, keep one entry
+ * per line in this form.
+ *
+ * Limits, checked at compile time unless noted:
+ *   - At most 126 fields, the name lookup holds field indices as int8_t
+ *     (settings_lookup.cpp).
+ *   - size - 1 at most NON_VOL_RECORD_MAX: 240 bytes, 2048 with ENABLE_TLS
+ *     (runtime_settings.c).
+ *   - Record keys are a 15-bit hash of the name, two names sharing a key are
+ *     caught by an assert of DEBUG builds only.
+ *   - Every field takes NON_VOL_RECORD_PAGES(size - 1) flash pages per slot
+ *     in each journal block and two entries of the RAM index, both derived
+ *     from this list (non_volatile.h). The journal region at the end of the
+ *     flash grows by NON_VOL_BLOCKS times that, the program image must stay
+ *     below it. With 60 fields of 100 bytes the region is 128 KiB, 176 KiB
+ *     with ENABLE_TLS.
+ */
+#ifndef SETTINGS_SCHEMA_H_SENTRY
+#define SETTINGS_SCHEMA_H_SENTRY
+
+#define SETTINGS_SCHEMA(X)                                                     \
+  X(wifi_ssid, 33, WIFI, "text", "Wi-Fi SSID")                                 \
+  X(wifi_pass, 64, WIFI, "password", "Wi-Fi Password")                         \
+  X(tls_mqtt_broker_hostname, 200, BROKER, "text", "MQTT Broker Hostname")     \
+  X(tls_mqtt_broker_port, 6, BROKER, "number", "MQTT Broker Port")             \
+  X(tls_mqtt_broker_CN, 200, BROKER, "text", "MQTT Common Name")               \
+  X(tls_mqtt_client_id, 100, CLIENT, "text", "MQTT Client ID")                 \
+  X(tls_mqtt_client_name, 100, CLIENT, "text", "MQTT Client Name")             \
+  X(tls_mqtt_client_password, 100, CLIENT, "password", "MQTT Client Password")
+
+#endif // SETTINGS_SCHEMA_H_SENTRY
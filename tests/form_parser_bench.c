@@ -0,0 +1,54 @@
+/*
+ * Throughput of form_parser on a settings form body, fed in chunks of a TCP
+ * segment as lwIP delivers them. Prints the decoded megabytes per second of
+ * the host, a relative measure for changes of the parser.
+ */
+#include "form_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK_SIZE 1460
+#define ROUNDS 2000
+
+static const char form_body[] =
+    "wifi_ssid=My+Home+Network&wifi_pass=p%40ssw0rd%21%23&"
+    "tls_mqtt_broker_hostname=broker.example.com&tls_mqtt_broker_port=8883&"
+    "tls_mqtt_broker_CN=broker.example.com&tls_mqtt_client_id=greenhouse-01&"
+    "tls_mqtt_client_name=greenhouse&"
+    "tls_mqtt_client_password=%C3%A9t%C3%A9+2024%2F%26%3D%25";
+
+static unsigned long fields = 0;
+
+static void count_field(const char *key, const char *value) {
+  (void)key;
+  (void)value;
+  fields++;
+}
+
+int main() {
+  // Several forms back to back, so a body spans many chunks
+  static char body[64 * sizeof(form_body)];
+  size_t len = 0;
+  while (len + sizeof(form_body) < sizeof(body)) {
+    memcpy(&body[len], form_body, sizeof(form_body) - 1);
+    len += sizeof(form_body) - 1;
+    body[len++] = '&';
+  }
+  form_parser_t parser;
+  clock_t start = clock();
+  for (int round = 0; round < ROUNDS; round++) {
+    form_parser_init(&parser, count_field);
+    for (size_t offset = 0; offset < len; offset += CHUNK_SIZE) {
+      size_t chunk = len - offset < CHUNK_SIZE ? len - offset : CHUNK_SIZE;
+      form_parser_feed(&parser, &body[offset], chunk);
+    }
+    form_parser_finish(&parser);
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double megabytes = (double)len * ROUNDS / 1e6;
+  printf("form_parser: %.1f MB in %.3f s, %.1f MB/s, %lu fields\n", megabytes,
+         seconds, seconds > 0 ? megabytes / seconds : 0.0, fields);
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Property test of form_parser: a body must decode to the same pairs however
+ * lwIP splits it into chunks. Known bodies are checked against their expected
+ * pairs for every split into two and three chunks and byte by byte; random
+ * pairs are URL-encoded, fed in random chunks and compared with the originals.
+ */
+#include "form_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PAIRS 16
+#define RANDOM_BODIES 2000
+
+typedef struct {
+  char key[FORM_MAX_KEY_LEN + 1];
+  char value[FORM_MAX_VALUE_LEN + 1];
+} pair_t;
+
+typedef struct {
+  pair_t pairs[MAX_PAIRS];
+  int count;
+} pairs_t;
+
+/* Pairs received from the parser, the field function takes no context */
+static pairs_t received;
+static int failures = 0;
+
+static void record_field(const char *key, const char *value) {
+  if (received.count < MAX_PAIRS) {
+    strcpy(received.pairs[received.count].key, key);
+    strcpy(received.pairs[received.count].value, value);
+  }
+  received.count++;
+}
+
+/* Parses the body split at the given offsets, in ascending order */
+static void parse_split(const char *body, size_t len, const size_t *splits,
+                        int split_count) {
+  form_parser_t parser;
+  received.count = 0;
+  form_parser_init(&parser, record_field);
+  size_t start = 0;
+  for (int i = 0; i <= split_count; i++) {
+    size_t end = i < split_count ? splits[i] : len;
+    form_parser_feed(&parser, body + start, end - start);
+    start = end;
+  }
+  form_parser_finish(&parser);
+}
+
+static int same_pairs(const pairs_t *expected) {
+  if (received.count != expected->count) {
+    return 0;
+  }
+  for (int i = 0; i < expected->count; i++) {
+    if (strcmp(received.pairs[i].key, expected->pairs[i].key) != 0 ||
+        strcmp(received.pairs[i].value, expected->pairs[i].value) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void check_split(const char *name, const char *body, size_t len,
+                        const size_t *splits, int split_count,
+                        const pairs_t *expected) {
+  parse_split(body, len, splits, split_count);
+  if (same_pairs(expected)) {
+    return;
+  }
+  failures++;
+  printf("FAIL %s: %d pairs instead of %d, splits", name, received.count,
+         expected->count);
+  for (int i = 0; i < split_count; i++) {
+    printf(" %zu", splits[i]);
+  }
+  printf("\n");
+}
+
+/* Every split into two and three chunks, and one byte per chunk */
+static void check_all_splits(const char *name, const char *body,
+                             const pairs_t *expected) {
+  size_t len = strlen(body);
+  size_t splits[2];
+  check_split(name, body, len, NULL, 0, expected);
+  for (splits[0] = 0; splits[0] <= len; splits[0]++) {
+    check_split(name, body, len, splits, 1, expected);
+    for (splits[1] = splits[0]; splits[1] <= len; splits[1]++) {
+      check_split(name, body, len, splits, 2, expected);
+    }
+  }
+  form_parser_t parser;
+  received.count = 0;
+  form_parser_init(&parser, record_field);
+  for (size_t i = 0; i < len; i++) {
+    form_parser_feed(&parser, &body[i], 1);
+  }
+  form_parser_finish(&parser);
+  if (!same_pairs(expected)) {
+    failures++;
+    printf("FAIL %s: byte by byte\n", name);
+  }
+}
+
+typedef struct {
+  const char *name;
+  const char *body;
+  pairs_t expected;
+} known_body_t;
+
+static const known_body_t known_bodies[] = {
+    {"plain", "wifi_ssid=home&wifi_pass=secret",
+     {{{"wifi_ssid", "home"}, {"wifi_pass", "secret"}}, 2}},
+    {"plus", "name=a+b++c", {{{"name", "a b  c"}}, 1}},
+    {"escapes", "k%3D=%41%62%2b%26%25", {{{"k=", "Ab+&%"}}, 1}},
+    {"lower hex", "k=%c3%a9", {{{"k", "\xc3\xa9"}}, 1}},
+    {"broken escapes", "a=%zz&b=%4&c=%", {{{"a", "%zz"}, {"b", "%4"},
+                                          {"c", "%"}}, 3}},
+    {"escape before separator", "a=%4&b=1", {{{"a", "%4"}, {"b", "1"}}, 2}},
+    {"second equals", "a=b=c", {{{"a", "b=c"}}, 1}},
+    {"no value", "a&b=&c=1", {{{"a", ""}, {"b", ""}, {"c", "1"}}, 3}},
+    {"empty pairs", "&&a=1&&", {{{"a", "1"}}, 1}},
+    {"empty key", "=v&a=1", {{{"a", "1"}}, 1}},
+    {"empty body", "", {{{"", ""}}, 0}},
+};
+
+/* Keys and values at the length limits, longer pairs are dropped */
+static void check_limits() {
+  static char body[512];
+  pairs_t expected = {.count = 2};
+  memset(expected.pairs[0].key, 'k', FORM_MAX_KEY_LEN);
+  expected.pairs[0].key[FORM_MAX_KEY_LEN] = 0;
+  memset(expected.pairs[0].value, 'v', FORM_MAX_VALUE_LEN);
+  expected.pairs[0].value[FORM_MAX_VALUE_LEN] = 0;
+  strcpy(expected.pairs[1].key, "last");
+  strcpy(expected.pairs[1].value, "1");
+  snprintf(body, sizeof(body), "%s=%s&%sk=1&a=%sv&last=1",
+           expected.pairs[0].key, expected.pairs[0].value,
+           expected.pairs[0].key, expected.pairs[0].value);
+  check_all_splits("limits", body, &expected);
+}
+
+/* Deterministic generator, so a failure reproduces */
+static uint32_t random_state = 1;
+
+static uint32_t next_random() {
+  random_state = random_state * 1103515245u + 12345u;
+  return random_state >> 16;
+}
+
+static void random_text(char *text, int max_len, int min_len) {
+  int len = min_len + (int)(next_random() % (uint32_t)(max_len - min_len + 1));
+  for (int i = 0; i < len; i++) {
+    // Printable chars most of the time, any byte but the terminator otherwise
+    text[i] = next_random() % 4 ? (char)(' ' + next_random() % 95)
+                                : (char)(1 + next_random() % 255);
+  }
+  text[len] = 0;
+}
+
+static size_t encode(char *out, const char *text) {
+  static const char unreserved[] = "-_.~*";
+  size_t len = 0;
+  for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+    if ((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'z') ||
+        (*c >= 'A' && *c <= 'Z') || strchr(unreserved, *c)) {
+      out[len++] = (char)*c;
+    } else if (*c == ' ' && next_random() % 2) {
+      out[len++] = '+';
+    } else {
+      len += sprintf(&out[len], next_random() % 2 ? "%%%02X" : "%%%02x", *c);
+    }
+  }
+  return len;
+}
+
+static void check_random_bodies() {
+  static char body[MAX_PAIRS * 3 * (FORM_MAX_KEY_LEN + FORM_MAX_VALUE_LEN + 2)];
+  for (int n = 0; n < RANDOM_BODIES; n++) {
+    pairs_t expected = {.count = 1 + (int)(next_random() % MAX_PAIRS)};
+    size_t len = 0;
+    for (int i = 0; i < expected.count; i++) {
+      random_text(expected.pairs[i].key, FORM_MAX_KEY_LEN, 1);
+      random_text(expected.pairs[i].value, FORM_MAX_VALUE_LEN, 0);
+      if (i > 0) {
+        body[len++] = '&';
+      }
+      len += encode(&body[len], expected.pairs[i].key);
+      body[len++] = '=';
+      len += encode(&body[len], expected.pairs[i].value);
+    }
+    size_t splits[8];
+    int split_count = (int)(next_random() % 9);
+    for (int i = 0; i < split_count; i++) {
+      splits[i] = next_random() % (len + 1);
+    }
+    // Sorted, as offsets into the body
+    for (int i = 1; i < split_count; i++) {
+      for (int j = i; j > 0 && splits[j - 1] > splits[j]; j--) {
+        size_t swap = splits[j];
+        splits[j] = splits[j - 1];
+        splits[j - 1] = swap;
+      }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "random body %d", n);
+    check_split(name, body, len, splits, split_count, &expected);
+  }
+}
+
+int main() {
+  for (size_t i = 0; i < sizeof(known_bodies) / sizeof(known_bodies[0]); i++) {
+    check_all_splits(known_bodies[i].name, known_bodies[i].body,
+                     &known_bodies[i].expected);
+  }
+  check_limits();
+  check_random_bodies();
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("form_parser: all checks passed\n");
+  return 0;
+}
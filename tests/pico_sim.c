@@ -0,0 +1,111 @@
+#include "pico_sim.h"
+#include "crc32.h"
+
+#include <hardware/flash.h>
+#include <pico/multicore.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+uint32_t sim_erase_us = 0;
+uint32_t sim_program_us = 0;
+atomic_bool sim_lockout;
+atomic_bool sim_sensor_transaction;
+atomic_uint sim_erases;
+atomic_uint sim_programs;
+atomic_uint sim_misuses;
+
+void sim_init() {
+  memset(sim_flash, 0xff, sizeof(sim_flash));
+  atomic_store(&sim_lockout, false);
+  atomic_store(&sim_sensor_transaction, false);
+  atomic_store(&sim_erases, 0);
+  atomic_store(&sim_programs, 0);
+  atomic_store(&sim_misuses, 0);
+}
+
+uint32_t sim_time_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * 1000000u +
+                    (uint64_t)now.tv_nsec / 1000u);
+}
+
+void sim_sleep_until_us(uint32_t time_us) {
+  int32_t left;
+  while ((left = (int32_t)(time_us - sim_time_us())) > 0) {
+    struct timespec wait = {.tv_sec = left / 1000000,
+                            .tv_nsec = (left % 1000000) * 1000L};
+    nanosleep(&wait, NULL);
+  }
+}
+
+void sim_core_fetch() {
+  while (atomic_load(&sim_lockout)) {
+    sched_yield();
+  }
+}
+
+static void misuse(const char *what, uint32_t flash_offs) {
+  atomic_fetch_add(&sim_misuses, 1);
+  printf("FLASH MISUSE %s at 0x%08lx\n", what, (unsigned long)flash_offs);
+}
+
+static void check_op(uint32_t flash_offs, size_t count, uint32_t grid) {
+  if (!atomic_load(&sim_lockout)) {
+    misuse("without lockout", flash_offs);
+  }
+  if (atomic_load(&sim_sensor_transaction)) {
+    misuse("in a sensor transaction", flash_offs);
+  }
+  if (flash_offs % grid || count % grid || count > sizeof(sim_flash) ||
+      flash_offs > sizeof(sim_flash) - count) {
+    misuse("off the grid", flash_offs);
+  }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  check_op(flash_offs, count, FLASH_SECTOR_SIZE);
+  sim_sleep_until_us(sim_time_us() + sim_erase_us);
+  memset(&sim_flash[flash_offs], 0xff, count);
+  atomic_fetch_add(&sim_erases, 1);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data,
+                         size_t count) {
+  check_op(flash_offs, count, FLASH_PAGE_SIZE);
+  sim_sleep_until_us(sim_time_us() + sim_program_us);
+  for (size_t i = 0; i < count; i++) {
+    // Programming only clears bits
+    if ((data[i] & sim_flash[flash_offs + i]) != data[i]) {
+      misuse("over bits not erased", flash_offs + (uint32_t)i);
+      break;
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    sim_flash[flash_offs + i] &= data[i];
+  }
+  atomic_fetch_add(&sim_programs, 1);
+}
+
+void multicore_lockout_start_blocking() {
+  if (atomic_exchange(&sim_lockout, true)) {
+    misuse("nested lockout", 0);
+  }
+}
+
+void multicore_lockout_end_blocking() { atomic_store(&sim_lockout, false); }
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *bytes++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,49 @@
+/*
+ * Flash, core lockout and CRC32 of the Pico SDK simulated on the host, so
+ * non_volatile.c runs between two threads standing in for the cores. The
+ * flash operations take as long as set below and count every misuse: an
+ * operation without the other core locked out, during a sensor transaction,
+ * off the page or segment grid, or programming bits not erased.
+ */
+#ifndef PICO_SIM_H_SENTRY
+#define PICO_SIM_H_SENTRY
+
+#include <boards/pico_w.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+/* Duration of a segment erase and a page program */
+extern uint32_t sim_erase_us;
+extern uint32_t sim_program_us;
+
+/* The core running from the flash is locked out */
+extern atomic_bool sim_lockout;
+/* Set by the sensor thread between hold and release of the writes */
+extern atomic_bool sim_sensor_transaction;
+
+extern atomic_uint sim_erases;
+extern atomic_uint sim_programs;
+extern atomic_uint sim_misuses;
+
+/**
+ * @brief Erases the whole simulated flash and clears the counters.
+ */
+void sim_init();
+/**
+ * @brief Microseconds of a monotonic clock, wraps like time_us_32().
+ */
+uint32_t sim_time_us();
+/**
+ * @brief Sleeps until sim_time_us() reaches the time.
+ */
+void sim_sleep_until_us(uint32_t time_us);
+/**
+ * @brief Stands for the next instruction fetched from the flash by the
+ * sensor core, it stalls while the core is locked out.
+ */
+void sim_core_fetch();
+
+#endif // PICO_SIM_H_SENTRY
@@ -0,0 +1,228 @@
+/*
+ * Sensor transactions against the flash writes of the net core. A thread
+ * standing in for the net core writes journal records without pause, with
+ * garbage collections and block erases. A thread standing in for the sensor
+ * core collects a simulated DHT acquisition ring inside hold/release of the
+ * writes, while a third thread plays the DMA chain that fills the ring every
+ * period from RAM. The run must not lose a period, and no flash operation may
+ * land inside a transaction. A control run lets the chain stall while the
+ * flash is busy, as a chain reading XIP would, to show the losses are seen.
+ */
+#include "non_volatile.h"
+#include "pico_sim.h"
+#include "sample_loss.h"
+#include "utility.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Time runs 1000 times faster than on the board: a 5 s period becomes 5 ms
+ * and the operations are far slower than the real 45 ms erase and 0.4 ms
+ * page program, relative to the period */
+#define PERIOD_US 5000
+#define ERASE_US 1000
+#define PROGRAM_US 100
+/* DHT_ACQUISITION_SLOTS of the ring */
+#define RING_SLOTS 8
+/* Work of a transaction, like the validation of the frames */
+#define TRANSACTION_US 300
+/* Records of a burst of the net core and the pause after it. The mutex is
+ * not fair, a burst delays a transaction by its whole length, which the ring
+ * must cover */
+#define BURST_WRITES 25
+#define BURST_PAUSE_US (2 * PERIOD_US)
+#define RUN_US 1000000
+#define CONTROL_RUN_US 300000
+
+static const uint16_t keys[] = {
+    NON_VOL_KEY_WIFI_CACHE, NON_VOL_KEY_SETTINGS_HEADER,
+    NON_VOL_KEY_SETTINGS_HEADER_B, NON_VOL_KEY_SETTINGS_ACTIVE,
+    NON_VOL_KEY_DHCP_LEASES};
+
+static struct {
+  _Atomic uint32_t time_us;
+  atomic_bool fresh;
+} ring[RING_SLOTS];
+
+static atomic_bool running;
+/* The chain skips the periods the flash is busy in */
+static bool chain_stalls;
+
+static struct {
+  sample_loss_t loss;
+  uint32_t frames;
+  uint32_t transactions;
+  uint32_t lockouts_inside; // Transactions that saw the lockout
+  uint32_t max_wait_us;     // Longest wait for the writes to be held
+} sensor;
+
+static struct {
+  uint32_t writes;
+  uint32_t failures;
+  uint8_t last[ARRAY_LENGTH(keys)][NON_VOL_SMALL_RECORD_MAX];
+  uint16_t last_length[ARRAY_LENGTH(keys)];
+} net;
+
+static int failures = 0;
+
+static void *chain_thread(void *arg) {
+  (void)arg;
+  uint32_t due = sim_time_us() + PERIOD_US;
+  unsigned slot = 0;
+  while (atomic_load(&running)) {
+    sim_sleep_until_us(due);
+    if (!chain_stalls || !atomic_load(&sim_lockout)) {
+      atomic_store(&ring[slot].time_us, due);
+      atomic_store(&ring[slot].fresh, true);
+      slot = (slot + 1) % RING_SLOTS;
+    }
+    due += PERIOD_US;
+  }
+  return NULL;
+}
+
+/* Fresh frames of the ring in the order they were taken */
+static void collect_ring() {
+  uint32_t times[RING_SLOTS];
+  unsigned count = 0;
+  for (unsigned i = 0; i < RING_SLOTS; i++) {
+    if (atomic_exchange(&ring[i].fresh, false)) {
+      uint32_t time_us = atomic_load(&ring[i].time_us);
+      unsigned j = count++;
+      for (; j > 0 && (int32_t)(times[j - 1] - time_us) > 0; j--) {
+        times[j] = times[j - 1];
+      }
+      times[j] = time_us;
+    }
+  }
+  for (unsigned i = 0; i < count; i++) {
+    sample_loss_add(&sensor.loss, times[i]);
+  }
+  sensor.frames += count;
+}
+
+static void *sensor_thread(void *arg) {
+  (void)arg;
+  while (atomic_load(&running)) {
+    sim_core_fetch();
+    uint32_t start = sim_time_us();
+    non_volatile_hold_writes();
+    uint32_t waited = sim_time_us() - start;
+    if (waited > sensor.max_wait_us) {
+      sensor.max_wait_us = waited;
+    }
+    atomic_store(&sim_sensor_transaction, true);
+    if (atomic_load(&sim_lockout)) {
+      sensor.lockouts_inside++;
+    }
+    collect_ring();
+    sim_sleep_until_us(sim_time_us() + TRANSACTION_US);
+    atomic_store(&sim_sensor_transaction, false);
+    non_volatile_release_writes();
+    sensor.transactions++;
+    sim_sleep_until_us(sim_time_us() + PERIOD_US / 2);
+  }
+  return NULL;
+}
+
+static void *net_thread(void *arg) {
+  (void)arg;
+  uint8_t data[NON_VOL_SMALL_RECORD_MAX];
+  while (atomic_load(&running)) {
+    unsigned i = net.writes % ARRAY_LENGTH(keys);
+    uint16_t length = (uint16_t)(1 + net.writes * 7 % sizeof(data));
+    memset(data, (int)(net.writes & 0xff), length);
+    if (write_in_non_volatile(keys[i], data, length) == 0) {
+      memcpy(net.last[i], data, length);
+      net.last_length[i] = length;
+    } else {
+      net.failures++;
+    }
+    net.writes++;
+    if (net.writes % BURST_WRITES == 0) {
+      sim_sleep_until_us(sim_time_us() + BURST_PAUSE_US);
+    }
+  }
+  return NULL;
+}
+
+static void run(uint32_t run_us) {
+  memset(&sensor, 0, sizeof(sensor));
+  sample_loss_init(&sensor.loss, PERIOD_US);
+  net.writes = 0;
+  net.failures = 0;
+  for (unsigned i = 0; i < RING_SLOTS; i++) {
+    atomic_store(&ring[i].fresh, false);
+  }
+  atomic_store(&sim_erases, 0);
+  atomic_store(&sim_programs, 0);
+  atomic_store(&running, true);
+  pthread_t threads[3];
+  pthread_create(&threads[0], NULL, chain_thread, NULL);
+  pthread_create(&threads[1], NULL, sensor_thread, NULL);
+  pthread_create(&threads[2], NULL, net_thread, NULL);
+  sim_sleep_until_us(sim_time_us() + run_us);
+  atomic_store(&running, false);
+  for (unsigned i = 0; i < ARRAY_LENGTH(threads); i++) {
+    pthread_join(threads[i], NULL);
+  }
+  printf("%u transactions, %u frames, %u lost, longest wait %u us, "
+         "%u writes, %u erases, %u programs\n",
+         sensor.transactions, sensor.frames, sensor.loss.lost,
+         sensor.max_wait_us, net.writes, atomic_load(&sim_erases),
+         atomic_load(&sim_programs));
+}
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    failures++;
+    printf("FAIL %s\n", what);
+  }
+}
+
+static void check_sample_loss() {
+  sample_loss_t loss;
+  sample_loss_init(&loss, 1000);
+  check(sample_loss_add(&loss, 0xfffff000u) == 0, "first sample");
+  check(sample_loss_add(&loss, 0xfffff000u + 1400) == 0, "late sample");
+  check(sample_loss_add(&loss, 0xfffff000u + 4100) == 2, "clock wrap gap");
+  check(loss.lost == 2, "lost periods");
+}
+
+int main() {
+  check_sample_loss();
+  sim_init();
+  sim_erase_us = ERASE_US;
+  sim_program_us = PROGRAM_US;
+
+  run(RUN_US);
+  check(atomic_load(&sim_misuses) == 0, "flash misuse");
+  check(sensor.lockouts_inside == 0, "lockout inside a transaction");
+  check(sensor.loss.lost == 0, "lost DHT periods");
+  check(sensor.frames >= RUN_US / PERIOD_US / 2, "too few frames");
+  check(atomic_load(&sim_erases) > 0, "no block erased");
+  check(net.failures == 0, "journal write failed");
+  for (unsigned i = 0; i < ARRAY_LENGTH(keys); i++) {
+    uint8_t data[NON_VOL_SMALL_RECORD_MAX];
+    uint16_t length = 0;
+    const uint8_t *stored = map_non_volatile(keys[i], &length);
+    check(stored != NULL && length == net.last_length[i] &&
+              memcmp(stored, net.last[i], length) == 0 &&
+              read_from_non_volatile(keys[i], data, length) == length,
+          "journal record not the last written");
+  }
+
+  // Erases of several periods with the chain stalled must show as losses
+  chain_stalls = true;
+  sim_erase_us = 3 * PERIOD_US;
+  run(CONTROL_RUN_US);
+  check(sensor.loss.lost > 0, "stalled chain not detected");
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("sensor_window: all checks passed\n");
+  return 0;
+}
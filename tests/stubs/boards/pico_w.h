@@ -0,0 +1,7 @@
+/* Host stand-in for the Pico W board header */
+#ifndef BOARDS_PICO_W_STUB_H_SENTRY
+#define BOARDS_PICO_W_STUB_H_SENTRY
+
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+#endif // BOARDS_PICO_W_STUB_H_SENTRY
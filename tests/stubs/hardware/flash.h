@@ -0,0 +1,15 @@
+/* Host stand-in, the operations act on the flash simulated by pico_sim.c */
+#ifndef HARDWARE_FLASH_STUB_H_SENTRY
+#define HARDWARE_FLASH_STUB_H_SENTRY
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data,
+                         size_t count);
+
+#endif // HARDWARE_FLASH_STUB_H_SENTRY
@@ -0,0 +1,10 @@
+/* Host stand-in, XIP reads land in the flash simulated by pico_sim.c */
+#ifndef HARDWARE_REGS_ADDRESSMAP_STUB_H_SENTRY
+#define HARDWARE_REGS_ADDRESSMAP_STUB_H_SENTRY
+
+#include <stdint.h>
+
+extern uint8_t sim_flash[];
+#define XIP_BASE ((uintptr_t)sim_flash)
+
+#endif // HARDWARE_REGS_ADDRESSMAP_STUB_H_SENTRY
@@ -0,0 +1,5 @@
+/* Host stand-in for the interrupt numbers, none are used by the host tests */
+#ifndef HARDWARE_REGS_INTCTRL_STUB_H_SENTRY
+#define HARDWARE_REGS_INTCTRL_STUB_H_SENTRY
+
+#endif // HARDWARE_REGS_INTCTRL_STUB_H_SENTRY
@@ -0,0 +1,10 @@
+/* Host stand-in, a host thread has no interrupts to disable */
+#ifndef HARDWARE_SYNC_STUB_H_SENTRY
+#define HARDWARE_SYNC_STUB_H_SENTRY
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+#endif // HARDWARE_SYNC_STUB_H_SENTRY
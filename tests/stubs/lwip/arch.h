@@ -0,0 +1,7 @@
+/* Host stand-in for the lwIP architecture header */
+#ifndef LWIP_ARCH_STUB_H_SENTRY
+#define LWIP_ARCH_STUB_H_SENTRY
+
+#include <pico.h>
+
+#endif // LWIP_ARCH_STUB_H_SENTRY
@@ -0,0 +1,13 @@
+/* Host stand-in for the Pico SDK base header */
+#ifndef PICO_STUB_H_SENTRY
+#define PICO_STUB_H_SENTRY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#endif // PICO_STUB_H_SENTRY
@@ -0,0 +1,8 @@
+/* Host stand-in, pico_sim.c records the lockout of the other core */
+#ifndef PICO_MULTICORE_STUB_H_SENTRY
+#define PICO_MULTICORE_STUB_H_SENTRY
+
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#endif // PICO_MULTICORE_STUB_H_SENTRY
@@ -0,0 +1,21 @@
+/* Host stand-in, a Pico SDK mutex is a pthread mutex between host threads */
+#ifndef PICO_MUTEX_STUB_H_SENTRY
+#define PICO_MUTEX_STUB_H_SENTRY
+
+#include <pthread.h>
+
+typedef struct {
+  pthread_mutex_t lock;
+} mutex_t;
+
+#define auto_init_mutex(name) static mutex_t name = {PTHREAD_MUTEX_INITIALIZER}
+
+static inline void mutex_enter_blocking(mutex_t *mtx) {
+  pthread_mutex_lock(&mtx->lock);
+}
+
+static inline void mutex_exit(mutex_t *mtx) {
+  pthread_mutex_unlock(&mtx->lock);
+}
+
+#endif // PICO_MUTEX_STUB_H_SENTRY
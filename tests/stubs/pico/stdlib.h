@@ -0,0 +1,8 @@
+/* Host stand-in for the Pico SDK header included by utility.h */
+#ifndef PICO_STDLIB_STUB_H_SENTRY
+#define PICO_STDLIB_STUB_H_SENTRY
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif // PICO_STDLIB_STUB_H_SENTRY
@@ -218,43 +218,14 @@ static void tls_mqtt_incoming_data_cb(void *arg, const uint8_t *data,
     break;
   }
 }
-/* Called on publish request is completed. Errors are not handled, if message is
- lost it is ok
- */
-static void clean_message(MQTTMessage *message) {
-  if (message) {
-    // Free individual fields
-    if (message->topic) {
-      free(message->topic);
-      message->topic = NULL;
-    }
-    if (message->payload) {
-      free(message->payload);
-      message->payload = NULL;
-    }
-    // Free the message itself
-    free(message);
-  }
-}
-// Called on publish success, short on memory, and client disconnected. Because
-// sensor data is not that valuable just clean the memory without resending
+/* Called on publish success, timeout and with the client closed by the
+ * broker. Sensor data is not that valuable, a lost message is not resent.
+ * Nothing is allocated per message: lwIP copies topic and payload into the
+ * output buffer, and mqtt_disconnect drops pending requests without calling
+ * this */
 static void tls_mqtt_pub_request_cb(void *arg, err_t err) {
-  MQTTMessage *message = (MQTTMessage *)arg;
-  // Ensure pointer is valid before accessing
-  if (message) {
-    DEBUG_PRINT("tls_mqtt_pub_request_cb loop\n");
-    DEBUG_PRINT("Message topic: %s\nMessage data: %s\nStatus: %d\n",
-                message->topic ? message->topic : "NULL",
-                (const char *)message->payload ? (const char *)message->payload
-                                               : "NULL",
-                err);
-
-    // Clean up memory
-    clean_message(message);
-
-  } else {
-    DEBUG_PRINT("Invalid or already cleaned message pointer.\n");
-  }
+  (void)arg;
+  DEBUG_PRINT("tls_mqtt_pub_request_cb status: %d\n", err);
 }
 
 static void tls_mqtt_subscribe_request_cb(void *arg, err_t err) {
@@ -327,7 +298,7 @@ void tls_mqtt_sub_unsub_topics(MQTT_CLIENT_T *client, bool sub) {
 }
 err_t tls_mqtt_publish(MQTT_CLIENT_T *client, const char *topic,
                        const uint8_t *payload, uint16_t payload_size,
-                       uint8_t qos) {
+                       uint8_t qos, uint8_t retain) {
   if (!client->is_connected) {
     DEBUG_PRINT("tls_mqtt_publish client is disconnected\n");
     return ERR_OK;
@@ -336,41 +307,13 @@ err_t tls_mqtt_publish(MQTT_CLIENT_T *client, const char *topic,
     DEBUG_PRINT("tls_mqtt_publish empty message provided\n");
     return ERR_OK;
   }
-  uint16_t size;
-  // Allocate memory a for new message
-  MQTTMessage *new_message = (MQTTMessage *)malloc(sizeof(MQTTMessage));
-  if (new_message == NULL) {
-    return ERR_MEM;
-  }
-  new_message->topic = NULL;
-  new_message->payload = NULL;
-  new_message->payload_length = 0;
-  // Copy topic
-  size = strlen(topic);
-  new_message->topic = (char *)malloc(size + 1);
-  if (new_message->topic == NULL) {
-    clean_message(new_message);
-    return ERR_MEM;
-  }
-  strcpy(new_message->topic, topic);
-  new_message->topic[size] = 0;
-  // Copy payload
-  new_message->payload = (uint8_t *)malloc(payload_size);
-  if (new_message->payload == NULL) {
-    clean_message(new_message);
-    return ERR_MEM;
-  }
-  memcpy(new_message->payload, payload, payload_size);
-  new_message->payload_length = payload_size;
-  uint8_t retain = 0;
+  DEBUG_PRINT("Message to be sent:\nTopic: %s\nText: %.*s\nLength: %d\n",
+              topic, payload_size, (const char *)payload, payload_size);
+  // lwIP copies the message into the output buffer of the client
   cyw43_arch_lwip_begin();
-  err_t err = mqtt_publish(client->mqtt_client, new_message->topic,
-                           new_message->payload, new_message->payload_length,
-                           qos, retain, tls_mqtt_pub_request_cb, new_message);
+  err_t err = mqtt_publish(client->mqtt_client, topic, payload, payload_size,
+                           qos, retain, tls_mqtt_pub_request_cb, NULL);
   cyw43_arch_lwip_end();
-  DEBUG_PRINT("Message to be sent:\nTopic: %s\nText: %s\nLength: %d\n",
-              new_message->topic, new_message->payload,
-              new_message->payload_length);
   return err;
 }
 
@@ -386,8 +329,7 @@ void tls_mqtt_deinit(MQTT_CLIENT_T **client_ptr) {
   if (ret) {
     tls_mqtt_sub_unsub_topics(client, false);
   }
-  // mqtt disconnect forces pending publish requests to be called with ERR_CONN
-  // so the messages are cleaned from the callback
+  // Pending publish requests are dropped, they hold no memory of the client
   cyw43_arch_lwip_begin();
   mqtt_disconnect(client->mqtt_client);
   cyw43_arch_lwip_end();
@@ -426,8 +368,7 @@ void tls_mqtt_clean(MQTT_CLIENT_T **client_ptr) {
     client->topics_states[i].topic_buffer_length = 0;
     client->topics_states[i].data_in = 0;
   }
-  // Free settings
-  free(client->settings);
+  // Settings belong to the caller of tls_mqtt_init
   client->settings = NULL;
   // Free mqtt client
   cyw43_arch_lwip_begin();
@@ -496,6 +437,31 @@ static TLS_MQTT_RET tls_mqtt_reconfigure_client(MQTT_CLIENT_T *state) {
   return TLS_MQTT_OK;
 }
 
+TLS_MQTT_RET tls_mqtt_reconnect(MQTT_CLIENT_T *state) {
+  cyw43_arch_lwip_begin();
+  /* No connection callback is called, so there is no automatic reconnect.
+   * In-flight QoS 1 publishes are dropped, they own no memory */
+  mqtt_disconnect(state->mqtt_client);
+  cyw43_arch_lwip_end();
+  state->is_connected = false;
+  // The new session starts without subscriptions
+  for (int i = 0; i < TLS_MQTT_NUMBER_OF_TOPICS; i++) {
+    state->topics_states[i].is_subscribed = false;
+    state->topics_states[i].topic_buffer_length = 0;
+    state->topics_states[i].data_in = 0;
+  }
+  TLS_MQTT_RET ret = tls_mqtt_reconfigure_client(state);
+  if (ret != TLS_MQTT_OK) {
+    state->err_state = ret;
+    return ret;
+  }
+  if (tls_mqtt_connect(state) != ERR_OK) {
+    state->err_state = TLS_MQTT_ERR_CONNECT;
+    return TLS_MQTT_ERR_CONNECT;
+  }
+  return TLS_MQTT_OK;
+}
+
 // Initialize MQTT client
 TLS_MQTT_RET
 tls_mqtt_init(MQTT_CLIENT_T **client_ptr, tls_mqtt_settings *settings,
@@ -525,7 +491,9 @@ tls_mqtt_init(MQTT_CLIENT_T **client_ptr, tls_mqtt_settings *settings,
   // Zeros addr structure
   memset(&client->remote_addr, 0, sizeof(ip_addr_t));
   // Create a TLS configuration
+  cyw43_arch_lwip_begin();
   client->mqtt_client = mqtt_client_new();
+  cyw43_arch_lwip_end();
   if (client->mqtt_client == NULL) {
     ret = TLS_MQTT_ERR_ALLOC;
     DEBUG_PRINT("error tls_mqtt_init(): %s\n", tls_mqtt_strerr(ret));
@@ -546,9 +514,11 @@ tls_mqtt_init(MQTT_CLIENT_T **client_ptr, tls_mqtt_settings *settings,
               ipaddr_ntoa(&client->remote_addr));
 
 #if ENABLE_TLS
-  ret = tls_mqtt_reconfigure_tls_config(client, (const uint8_t *)CA_CERT,
-                                        (const uint8_t *)CLIENT_KEY,
-                                        (const uint8_t *)CLIENT_CERT);
+  // Certs are parsed in place from the flash
+  ret = tls_mqtt_reconfigure_tls_config(
+      client, (const uint8_t *)get_settings_cert(SETTINGS_CA_CERT, NULL),
+      (const uint8_t *)get_settings_cert(SETTINGS_CLIENT_KEY, NULL),
+      (const uint8_t *)get_settings_cert(SETTINGS_CLIENT_CERT, NULL));
   if (ret != TLS_MQTT_OK) {
     tls_mqtt_clean(&client);
     return ret;
@@ -598,7 +568,7 @@ void run_dns_lookup(MQTT_CLIENT_T *state, const char *host) {
     break;
   }
   while (state->remote_addr.addr == 0 && state->err_state != TLS_MQTT_ERR_DNS) {
-#ifdef PICO_CYW43_ARCH_POLL
+#if PICO_CYW43_ARCH_POLL
     cyw43_arch_poll();
 #endif // PICO_CYW43_ARCH_POLL
     sleep_ms(1);
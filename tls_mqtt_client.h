@@ -49,15 +49,6 @@ typedef enum {
   TLS_MQTT_RECONF_CLIENT /**< Client reconfiguration required */
 } TLS_MQTT_RET;
 
-/**
- * @brief Represents an MQTT message to be published or received.
- */
-typedef struct {
-  char *topic;             /**< Pointer to the topic name. */
-  uint8_t *payload;        /**< Pointer to the payload data. */
-  uint16_t payload_length; /**< Length of the payload data. */
-} MQTTMessage;
-
 /**
  * @brief Represents the state of a subscription topic.
  */
@@ -180,11 +171,25 @@ TLS_MQTT_RET tls_mqtt_reconfigure_tls_config(MQTT_CLIENT_T *state,
                                              const uint8_t *client_key,
                                              const uint8_t *client_cert);
 
+/**
+ * @brief Starts a new MQTT session with the current credentials.
+ *
+ * Closes the connection, rebuilds the connect info from `settings` (client
+ * ID, user name and password) and connects again. The resolved broker address
+ * and the TLS configuration are reused.
+ *
+ * @param[in,out] state The MQTT client state.
+ * @return TLS_MQTT_OK once the connection is started, or an appropriate error
+ * code.
+ */
+TLS_MQTT_RET tls_mqtt_reconnect(MQTT_CLIENT_T *state);
+
 /**
  * @brief Cleans up the MQTT client state and resources.
  *
  * @param[in,out] client_ptr Pointer to the MQTT client.
  * @details Frees all memory allocated for the client and resets its state.
+ * The settings passed to tls_mqtt_init are not freed.
  */
 void tls_mqtt_clean(MQTT_CLIENT_T **client_ptr);
 
@@ -206,10 +211,8 @@ void tls_mqtt_deinit(MQTT_CLIENT_T **client_ptr);
  * @brief Publishes a message to an MQTT topic.
  *
  * This function publishes a message with the specified topic, payload, and QoS
- * to an MQTT client. The function handles memory allocation for the message
- * and ensures proper cleanup in case of errors. If the publication is
- * successful, the message is managed asynchronously by the MQTT library, and
- * its memory is freed in the associated callback (`tls_mqtt_pub_request_cb`).
+ * to an MQTT client. lwIP copies the message into the output buffer of the
+ * client, nothing is allocated per message.
  *
  * @param[in] client        Pointer to the MQTT client structure. Must not be
  * NULL.
@@ -219,19 +222,19 @@ void tls_mqtt_deinit(MQTT_CLIENT_T **client_ptr);
  * 0.
  * @param[in] qos           Quality of Service level for the message (0, 1, or
  * 2).
+ * @param[in] retain        Non-zero to ask the broker to retain the message.
  *
  * @return
  * - `ERR_OK` on successful queuing of the message.
- * - `ERR_MEM` if memory allocation fails.
+ * - `ERR_MEM` if the output buffer or the request slots are full.
  * - `ERR_ARG` if invalid arguments are provided.
  * - Other error codes depending on the underlying MQTT publish function.
  *
  * @note
- * - The `topic` and `payload` strings are copied into dynamically allocated
- *   memory, so the caller does not need to manage their lifetime after this
- *   function is called.
- * - The callback `tls_mqtt_pub_request_cb` is invoked after the publish
- *   operation is completed to clean up the allocated memory.
+ * - The `topic` and `payload` are copied before the function returns, so the
+ *   caller does not need to manage their lifetime after this call.
+ * - A QoS 1 or 2 request dropped by a disconnect holds no memory of the
+ *   caller, lwIP closes it without calling `tls_mqtt_pub_request_cb`.
  * - The function assumes the `client->mqtt_client` is properly initialized.
  *
  * @warning Ensure that the MQTT client is connected before calling this
@@ -246,7 +249,7 @@ void tls_mqtt_deinit(MQTT_CLIENT_T **client_ptr);
  * uint8_t qos = 1;
  *
  * err_t result = tls_mqtt_publish(&my_client, topic, (const uint8_t *)payload,
- * payload_size, qos); if (result != ERR_OK) { printf("Failed to publish
+ * payload_size, qos, 0); if (result != ERR_OK) { printf("Failed to publish
  * message, error code: %d\n", result);
  * }
  * @endcode
@@ -254,7 +257,7 @@ void tls_mqtt_deinit(MQTT_CLIENT_T **client_ptr);
 
 err_t tls_mqtt_publish(MQTT_CLIENT_T *client, const char *topic,
                        const uint8_t *payload, uint16_t payload_size,
-                       uint8_t qos);
+                       uint8_t qos, uint8_t retain);
 /**
  * @brief Subscribe or unsubscribe all subscription-based topics for the MQTT
  * client.
@@ -1,10 +1,20 @@
 #include "wifi_arch.h"
+#include "non_volatile.h"
 #include "utility.h"
+#include <assert.h>
 #include <boards/pico_w.h>
+#include <cyw43.h>
 #include <cyw43_ll.h>
+#include <lwip/dhcp.h>
+#include <lwip/dns.h>
+#include <lwip/etharp.h>
 #include <lwip/ip_addr.h>
 #include <lwip/netif.h>
 #include <pico/cyw43_arch.h>
+#include <string.h>
+
+static_assert(sizeof(wifi_join_cache_t) <= NON_VOL_SMALL_RECORD_MAX,
+              "The journal blocks are sized for a smaller wifi cache");
 
 int setup_ap(uint32_t country, const char *ssid, const char *pass,
              uint32_t auth) {
@@ -17,40 +27,219 @@ int setup_ap(uint32_t country, const char *ssid, const char *pass,
 
   return 0;
 }
-int setup_sta(uint32_t country, const char *ssid, const char *pass,
-              uint32_t auth, const char *hostname, ip_addr_t *ip,
-              ip_addr_t *mask, ip_addr_t *gw) {
-  int i = 0, res;
-  struct netif *net;
-  if (cyw43_arch_init_with_country(country)) {
+
+int read_wifi_join_cache(wifi_join_cache_t *cache) {
+  if (cache == NULL) {
     return 1;
   }
-  cyw43_arch_enable_sta_mode();
-  // Set up the hostname and make sure the changes take place
+  int length = read_from_non_volatile(
+      NON_VOL_KEY_WIFI_CACHE, (uint8_t *)cache, sizeof(wifi_join_cache_t));
+  if (length != sizeof(wifi_join_cache_t) || cache->flag != WIFI_CACHE_FLAG ||
+      cache->end_flag != WIFI_CACHE_FLAG) {
+    DEBUG_PRINT("Wi-Fi join cache is empty\n");
+    return 2;
+  }
+  return 0;
+}
+
+void write_wifi_join_cache(wifi_join_cache_t *cache) {
+  if (cache == NULL) {
+    return;
+  }
+  cache->flag = WIFI_CACHE_FLAG;
+  cache->end_flag = WIFI_CACHE_FLAG;
+  write_in_non_volatile(NON_VOL_KEY_WIFI_CACHE, (const uint8_t *)cache,
+                        sizeof(wifi_join_cache_t));
+}
+
+/* Waits until the STA link reaches target status. Returns the last status */
+static int wait_link_status(int (*get_status)(int itf), int target,
+                            uint32_t timeout_ms) {
+  absolute_time_t until = make_timeout_time_ms(timeout_ms);
+  int status = get_status(CYW43_ITF_STA);
+  while (status >= 0 && status != target &&
+         absolute_time_diff_us(get_absolute_time(), until) > 0) {
+#if PICO_CYW43_ARCH_POLL
+    cyw43_arch_poll();
+    cyw43_arch_wait_for_work_until(make_timeout_time_ms(10));
+#else
+    sleep_ms(10);
+#endif
+    status = get_status(CYW43_ITF_STA);
+  }
+  return status;
+}
+
+static int wifi_link_status(int itf) {
+  return cyw43_wifi_link_status(&cyw43_state, itf);
+}
+
+static int tcpip_link_status(int itf) {
+  return cyw43_tcpip_link_status(&cyw43_state, itf);
+}
+
+/* Joins the AP remembered in cache without scanning other channels. Once
+ * associated the cached DHCP lease is applied, DHCP keeps running and will
+ * correct the address if the server decided otherwise. Returns true once the
+ * link is up */
+static bool join_from_cache(const char *ssid, const char *pass, uint32_t auth,
+                            struct netif *net,
+                            const wifi_join_cache_t *cache) {
+  int res;
+  DEBUG_PRINT("Directed join on channel %u\n", (unsigned)cache->channel);
   cyw43_arch_lwip_begin();
-  net = &cyw43_state.netif[CYW43_ITF_STA];
+  res = cyw43_wifi_join(&cyw43_state, strlen(ssid), (const uint8_t *)ssid,
+                        pass == NULL ? 0 : strlen(pass), (const uint8_t *)pass,
+                        auth, cache->bssid, cache->channel);
   cyw43_arch_lwip_end();
-  if (hostname != NULL) {
+  if (res) {
+    return false;
+  }
+  if (wait_link_status(wifi_link_status, CYW43_LINK_JOIN,
+                       WIFI_FAST_JOIN_TIMEOUT_MS) != CYW43_LINK_JOIN) {
+    DEBUG_PRINT("Directed join failed\n");
     cyw43_arch_lwip_begin();
-    netif_set_hostname(net, hostname);
-    netif_set_up(net);
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    cyw43_arch_lwip_end();
+    return false;
+  }
+  /* There is no RTC surviving the reset, so the time spent offline is
+   * unknown. Leases shorter than WIFI_CACHE_MIN_LEASE_S are not reused */
+  uint32_t timeout_ms = WIFI_DHCP_TIMEOUT_MS;
+  if (cache->lease_time_s >= WIFI_CACHE_MIN_LEASE_S) {
+    cyw43_arch_lwip_begin();
+    netif_set_addr(net, &cache->ip, &cache->mask, &cache->gw);
+    dns_setserver(0, (const ip_addr_t *)&cache->dns);
     cyw43_arch_lwip_end();
+    timeout_ms = WIFI_FAST_JOIN_TIMEOUT_MS;
+    DEBUG_PRINT("Reused cached lease %s\n", ip4addr_ntoa(&cache->ip));
+  }
+  return wait_link_status(tcpip_link_status, CYW43_LINK_UP, timeout_ms) ==
+         CYW43_LINK_UP;
+}
+
+/* Fills the cache with the current association and lease. Returns true if
+ * the stored record is outdated: no valid record, or another AP, channel,
+ * address or gateway */
+static bool update_join_cache(struct netif *net, wifi_join_cache_t *cache) {
+  wifi_join_cache_t fresh;
+  uint32_t channel = 0;
+  memset(&fresh, 0, sizeof(fresh));
+  fresh.flag = WIFI_CACHE_FLAG;
+  fresh.end_flag = WIFI_CACHE_FLAG;
+  cyw43_arch_lwip_begin();
+  cyw43_wifi_get_bssid(&cyw43_state, fresh.bssid);
+  /* channel_info_t starts with the hardware channel */
+  cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(channel),
+              (uint8_t *)&channel, CYW43_ITF_STA);
+  ip4_addr_copy(fresh.ip, *netif_ip4_addr(net));
+  ip4_addr_copy(fresh.mask, *netif_ip4_netmask(net));
+  ip4_addr_copy(fresh.gw, *netif_ip4_gw(net));
+  ip4_addr_copy(fresh.dns, *ip_2_ip4(dns_getserver(0)));
+  struct dhcp *dhcp = netif_dhcp_data(net);
+  fresh.lease_time_s = dhcp == NULL ? 0 : dhcp->offered_t0_lease;
+  cyw43_arch_lwip_end();
+  fresh.channel = channel;
+  if (cache->flag == WIFI_CACHE_FLAG &&
+      memcmp(fresh.bssid, cache->bssid, sizeof(fresh.bssid)) == 0 &&
+      fresh.channel == cache->channel &&
+      ip4_addr_get_u32(&fresh.ip) == ip4_addr_get_u32(&cache->ip) &&
+      ip4_addr_get_u32(&fresh.gw) == ip4_addr_get_u32(&cache->gw)) {
+    return false;
+  }
+  memcpy(cache, &fresh, sizeof(fresh));
+  return true;
+}
+
+/* DHCP binding the cache was last checked against, a new one is checked */
+static struct {
+  bool bound;
+  ip4_addr_t ip;
+} dhcp_seen;
+
+void refresh_wifi_join_cache(wifi_join_cache_t *cache) {
+  if (cache == NULL) {
+    return;
+  }
+  cyw43_arch_lwip_begin();
+  struct netif *net = &cyw43_state.netif[CYW43_ITF_STA];
+  bool bound = dhcp_supplied_address(net);
+  ip4_addr_t ip;
+  ip4_addr_copy(ip, *netif_ip4_addr(net));
+  cyw43_arch_lwip_end();
+  bool new_binding =
+      bound && (!dhcp_seen.bound ||
+                ip4_addr_get_u32(&ip) != ip4_addr_get_u32(&dhcp_seen.ip));
+  dhcp_seen.bound = bound;
+  ip4_addr_copy(dhcp_seen.ip, ip);
+  if (new_binding && update_join_cache(net, cache)) {
+    DEBUG_PRINT("Wi-Fi join cache refreshed, %s\n", ip4addr_ntoa(&cache->ip));
+    write_wifi_join_cache(cache);
   }
+}
+
+void drop_wifi_join_cache(wifi_join_cache_t *cache) {
+  if (cache == NULL) {
+    return;
+  }
+  DEBUG_PRINT("Wi-Fi join cache dropped\n");
+  // A record without the flags reads as an empty cache
+  memset(cache, 0, sizeof(wifi_join_cache_t));
+  write_in_non_volatile(NON_VOL_KEY_WIFI_CACHE, (const uint8_t *)cache,
+                        sizeof(wifi_join_cache_t));
+}
+
+bool wifi_gateway_resolved() {
+  struct eth_addr *eth;
+  const ip4_addr_t *ip;
+  cyw43_arch_lwip_begin();
+  struct netif *net = &cyw43_state.netif[CYW43_ITF_STA];
+  bool resolved = !ip4_addr_isany(netif_ip4_gw(net)) &&
+                  etharp_find_addr(net, netif_ip4_gw(net), &eth, &ip) >= 0;
+  cyw43_arch_lwip_end();
+  return resolved;
+}
+
+/* Associates the enabled STA interface with ssid and waits for the link,
+ * the return values are the ones of setup_sta */
+static int join_sta(const char *ssid, const char *pass, uint32_t auth,
+                    ip_addr_t *ip, ip_addr_t *mask, ip_addr_t *gw,
+                    wifi_join_cache_t *cache, bool *fast_rejoin) {
+  int i = 0, res;
+  bool rejoined = false;
+  struct netif *net;
+  if (fast_rejoin != NULL) {
+    *fast_rejoin = false;
+  }
+  dhcp_seen.bound = false;
+  cyw43_arch_lwip_begin();
+  net = &cyw43_state.netif[CYW43_ITF_STA];
+  cyw43_arch_lwip_end();
   cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-  while (i++ < CONNECT_ATTEMPTS) {
-    res = cyw43_arch_wifi_connect_timeout_ms(ssid, pass, auth, 60000);
-    if (res == 0) {
-      break;
+  if (cache != NULL && cache->flag == WIFI_CACHE_FLAG &&
+      join_from_cache(ssid, pass, auth, net, cache)) {
+    rejoined = true;
+    res = 0;
+  } else {
+    while (i++ < CONNECT_ATTEMPTS) {
+      res = cyw43_arch_wifi_connect_timeout_ms(ssid, pass, auth, 60000);
+      if (res == 0) {
+        break;
+      }
+      /* Sleep between connections */
+      sleep_ms(5000);
     }
-    /* Sleep between connections */
-    sleep_ms(5000);
   }
   if (res != 0) {
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
     return 2;
   }
+  if (fast_rejoin != NULL) {
+    *fast_rejoin = rejoined;
+  }
   int flashrate = 1000;
-  int status = CYW43_LINK_UP + 1;
+  // The fast path has already waited for the link, skip LED signalling
+  int status = rejoined ? CYW43_LINK_UP : CYW43_LINK_UP + 1;
   while (status >= 0 && status != CYW43_LINK_UP) {
     int new_status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
     if (new_status != status) {
@@ -77,6 +266,65 @@ int setup_sta(uint32_t country, const char *ssid, const char *pass,
       netif_set_gw(net, gw);
     }
     cyw43_arch_lwip_end();
+    /* A full join waited for DHCP. The fast path may still run on the
+     * cached lease, refresh_wifi_join_cache() checks it once DHCP binds */
+    refresh_wifi_join_cache(cache);
   }
   return status;
 }
+
+int setup_sta(uint32_t country, const char *ssid, const char *pass,
+              uint32_t auth, const char *hostname, ip_addr_t *ip,
+              ip_addr_t *mask, ip_addr_t *gw, wifi_join_cache_t *cache,
+              bool *fast_rejoin) {
+  if (fast_rejoin != NULL) {
+    *fast_rejoin = false;
+  }
+  if (cyw43_arch_init_with_country(country)) {
+    return 1;
+  }
+  cyw43_arch_enable_sta_mode();
+  // Set up the hostname and make sure the changes take place
+  if (hostname != NULL) {
+    cyw43_arch_lwip_begin();
+    struct netif *net = &cyw43_state.netif[CYW43_ITF_STA];
+    netif_set_hostname(net, hostname);
+    netif_set_up(net);
+    cyw43_arch_lwip_end();
+  }
+  return join_sta(ssid, pass, auth, ip, mask, gw, cache, fast_rejoin);
+}
+
+int reconnect_sta(const char *ssid, const char *pass, uint32_t auth,
+                  wifi_join_cache_t *cache) {
+  DEBUG_PRINT("Leaving the Wi-Fi network to join %s\n", ssid);
+  cyw43_arch_lwip_begin();
+  cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+  cyw43_arch_lwip_end();
+  wait_link_status(wifi_link_status, CYW43_LINK_DOWN,
+                   WIFI_FAST_JOIN_TIMEOUT_MS);
+  return join_sta(ssid, pass, auth, NULL, NULL, NULL, cache, NULL);
+}
+
+void enable_ap_with_sta(const char *ssid, const char *pass, uint32_t auth) {
+  uint32_t channel = 0;
+  cyw43_arch_lwip_begin();
+  /* Both interfaces share the radio, the AP has to use the channel of the
+   * network the STA is associated with */
+  if (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_JOIN) {
+    cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(channel),
+                (uint8_t *)&channel, CYW43_ITF_STA);
+  }
+  cyw43_arch_lwip_end();
+  if (channel != 0) {
+    cyw43_wifi_ap_set_channel(&cyw43_state, channel);
+  }
+  cyw43_arch_enable_ap_mode(ssid, pass, auth);
+  DEBUG_PRINT("AP enabled alongside the STA on channel %lu\n",
+              (unsigned long)channel);
+}
+
+void disable_ap() {
+  cyw43_arch_disable_ap_mode();
+  DEBUG_PRINT("AP disabled\n");
+}
@@ -7,6 +7,34 @@
 #include <lwip/ip_addr.h>
 #include <pico/stdlib.h>
 #define CONNECT_ATTEMPTS 5
+/* Directed join on the cached channel should finish quickly, otherwise the
+ * full scan is performed */
+#define WIFI_FAST_JOIN_TIMEOUT_MS 3000
+/* Time given to DHCP once associated on the fast path without a lease */
+#define WIFI_DHCP_TIMEOUT_MS 10000
+/* Cached leases shorter than this are not reused after a reboot */
+#define WIFI_CACHE_MIN_LEASE_S 3600
+/* A join from the cache must reach the broker or the gateway within this
+ * time, otherwise the cache is dropped */
+#define WIFI_CACHE_VERIFY_TIMEOUT_MS 30000
+// Control if the Wi-Fi join cache was written into the flash
+#define WIFI_CACHE_FLAG 0x5A5A5A
+
+/**
+ * @brief Last successful STA association stored in the flash to skip the
+ * scan and the DHCP exchange on the next boot.
+ */
+typedef struct {
+  int flag;              ///< Set to WIFI_CACHE_FLAG before saving
+  uint8_t bssid[6];      ///< BSSID of the AP the device was associated with
+  uint32_t channel;      ///< Channel of the AP
+  ip4_addr_t ip;         ///< DHCP leased address
+  ip4_addr_t mask;       ///< DHCP leased netmask
+  ip4_addr_t gw;         ///< DHCP leased gateway
+  ip4_addr_t dns;        ///< First DNS server
+  uint32_t lease_time_s; ///< Lease time offered by the DHCP server
+  int end_flag;          ///< Should be equal to flag
+} wifi_join_cache_t;
 
 /**
  * @brief Initializes and sets up the Wi-Fi access point (AP) mode.
@@ -50,6 +78,12 @@ int setup_ap(uint32_t country, const char *ssid, const char *pass,
  * to use DHCP.
  * @param[in] gw        A pointer to the gateway address to assign. Pass
  * `NULL` to use DHCP.
+ * @param[in,out] cache A pointer to the last successful join. When valid a
+ * directed join on the cached BSSID/channel is tried first and the cached
+ * lease is reused. Updated and stored in the flash when DHCP binds, see
+ * refresh_wifi_join_cache. Pass `NULL` to always perform a full join.
+ * @param[out] fast_rejoin Set to true if the cached join succeeded. May be
+ * `NULL`.
  *
  * @return
  *   - `CYW43_LINK_UP` on successful connection and link establishment.
@@ -60,6 +94,85 @@ int setup_ap(uint32_t country, const char *ssid, const char *pass,
  */
 int setup_sta(uint32_t country, const char *ssid, const char *pass,
               uint32_t auth, const char *hostname, ip_addr_t *ip,
-              ip_addr_t *mask, ip_addr_t *gw);
+              ip_addr_t *mask, ip_addr_t *gw, wifi_join_cache_t *cache,
+              bool *fast_rejoin);
+/**
+ * @brief Leaves the current network and joins another one without
+ * reinitializing cyw43, lwIP keeps its connections on other interfaces.
+ *
+ * @param[in] ssid      The SSID of the Wi-Fi network to connect to.
+ * @param[in] pass      The password for the Wi-Fi network.
+ * @param[in] auth      The authentication type.
+ * @param[in,out] cache The Wi-Fi join cache, see setup_sta. Pass `NULL` to
+ * perform a full join.
+ *
+ * @return The same values as setup_sta, except `1`.
+ *
+ * @pre setup_sta was called.
+ */
+int reconnect_sta(const char *ssid, const char *pass, uint32_t auth,
+                  wifi_join_cache_t *cache);
+/**
+ * @brief Enables the AP interface next to the running STA.
+ *
+ * The AP is started on the channel of the network the STA is associated
+ * with, the STA connection is kept.
+ *
+ * @param ssid The SSID (network name) for the access point.
+ * @param pass The password for the access point. Can be NULL for open networks.
+ * @param auth The authentication type (e.g., CYW43_AUTH_WPA2_MIXED_PSK).
+ *
+ * @pre setup_sta was called.
+ */
+void enable_ap_with_sta(const char *ssid, const char *pass, uint32_t auth);
+/**
+ * @brief Disables the AP interface, the STA keeps running.
+ */
+void disable_ap();
+/**
+ * @brief Reads the Wi-Fi join cache from the flash.
+ *
+ * @param[out] cache A pointer to the cache to be populated.
+ *
+ * @return
+ *   - `0` on success.
+ *   - `1` if a `NULL` pointer is provided.
+ *   - `2` if the cache has not been written to flash memory yet.
+ */
+int read_wifi_join_cache(wifi_join_cache_t *cache);
+/**
+ * @brief Stores the Wi-Fi join cache in the flash.
+ *
+ * @param[in] cache A pointer to the cache to be written. Flags are set by the
+ * function.
+ */
+void write_wifi_join_cache(wifi_join_cache_t *cache);
+/**
+ * @brief Stores the current association and lease as the cache once DHCP
+ * bound, if the BSSID, channel, address or gateway differ from the cache.
+ *
+ * A binding is checked once, so the function is cheap to call from the net
+ * loop. After a join from the cache DHCP binds later and may correct the
+ * cached lease.
+ *
+ * @param[in,out] cache The Wi-Fi join cache. May be `NULL`.
+ *
+ * @pre setup_sta was called.
+ */
+void refresh_wifi_join_cache(wifi_join_cache_t *cache);
+/**
+ * @brief Clears the cache and stores it empty, so the next join performs the
+ * scan and the DHCP exchange.
+ *
+ * @param[out] cache The Wi-Fi join cache. May be `NULL`.
+ */
+void drop_wifi_join_cache(wifi_join_cache_t *cache);
+/**
+ * @brief Checks if the ARP entry of the STA gateway is resolved, the gateway
+ * answered on the current network.
+ *
+ * @pre setup_sta was called.
+ */
+bool wifi_gateway_resolved();
 
 #endif